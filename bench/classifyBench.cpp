@@ -0,0 +1,98 @@
+// Times the scalar, SSE4.1 and AVX2 cube classification kernels on a terrain-like
+// volume and checks that they produce the same cases and active cubes.
+//
+// Run with ./bench/classifyBench [dim ...], defaults to 100 and 256.
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <cstdlib>
+#include <cstring>
+
+#include "volumegrid.h"
+#include "classify.h"
+#include "simplexnoise1234.h"
+#include "benchclock.h"
+
+typedef unsigned (*ClassifyFunction)(const float *, const float *, const float *, const float *,
+    const unsigned, const float, unsigned char *, unsigned *);
+
+// Classify the whole volume, returning the number of active cubes and a checksum of the cases.
+static unsigned long long classifyVolume(const VolumeGrid<float> &data, const unsigned dim, const float isovalue,
+    ClassifyFunction classify, std::vector<unsigned char> &cases, std::vector<unsigned> &active, unsigned &activeCubes)
+{
+    unsigned long long checksum = 0;
+    activeCubes = 0;
+    for(unsigned x = 0; x < dim; x++)
+        for(unsigned y = 0; y < dim; y++)
+        {
+            const unsigned a = classify(data.row(x, y), data.row(x, y + 1), data.row(x + 1, y + 1), data.row(x + 1, y),
+                dim, isovalue, &cases[0], &active[0]);
+            for(unsigned i = 0; i < a; i++)
+                checksum = checksum * 31 + cases[active[i]] + active[i];
+            activeCubes += a;
+        }
+    return checksum;
+}
+
+int main(int argc, const char * argv[])
+{
+    std::vector<unsigned> dims;
+    for(int i = 1; i < argc; i++)
+        if(atoi(argv[i]) > 0)
+            dims.push_back(atoi(argv[i]));
+    if(dims.empty())
+    {
+        dims.push_back(100);
+        dims.push_back(256);
+    }
+
+    const char *names[] = {"scalar", "sse4.1", "avx2"};
+    ClassifyFunction functions[] = {classifyCubesScalar, classifyCubesSSE41, classifyCubesAVX2};
+    const bool supported[] = {true, classifySupportsSSE41(), classifySupportsAVX2()};
+    const float isovalue = 0.55;
+
+    std::cout << "classifyCubes uses: " << classifyImplementation() << std::endl;
+
+    for(unsigned d = 0; d < dims.size(); d++)
+    {
+        const unsigned dim = dims[d];
+        VolumeGrid<float> data(dim + 1, dim + 1, dim + 1);
+        for(unsigned x = 0; x < dim + 1; x++)
+            for(unsigned y = 0; y < dim + 1; y++)
+                for(unsigned z = 0; z < dim + 1; z++)
+                    data(x, y, z) = (float)y / (float)(dim + 1) + 0.25f * snoise3(x * 0.02f, y * 0.02f, z * 0.02f);
+
+        std::vector<unsigned char> cases(dim);
+        std::vector<unsigned> active(dim);
+
+        std::cout << std::endl << "Grid " << dim << "^3" << std::endl;
+        unsigned long long reference = 0;
+        for(unsigned f = 0; f < 3; f++)
+        {
+            if(!supported[f])
+            {
+                std::cout << "  " << std::setw(7) << names[f] << "  not supported" << std::endl;
+                continue;
+            }
+
+            // Best of five runs.
+            double best = 1e30;
+            unsigned long long checksum = 0;
+            unsigned activeCubes = 0;
+            for(unsigned run = 0; run < 5; run++)
+            {
+                double t = now();
+                checksum = classifyVolume(data, dim, isovalue, functions[f], cases, active, activeCubes);
+                best = std::min(best, now() - t);
+            }
+            if(f == 0)
+                reference = checksum;
+
+            std::cout << "  " << std::setw(7) << names[f] << std::fixed << std::setprecision(2)
+            << std::setw(9) << best * 1000.0 << " ms " << std::setw(7) << best * 1e9 / ((double)dim * dim * dim) << " ns/cube"
+            << "  active " << activeCubes << (checksum == reference ? "" : "  MISMATCH") << std::endl;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,137 @@
+// Times getting cell meshes into upload buffers by mapping MeshFiles, with the pages
+// dropped from the page cache first (cold) and still in it (warm), against
+// generating the cells again. The copy into an upload buffer stands in for
+// glBufferSubData, which reads the mapped pages the same way.
+//
+// Run with ./bench/meshLoadBench [dim ...], defaults to 100 and 200.
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <sstream>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "voxelData.h"
+#include "meshfile.h"
+#include "benchclock.h"
+
+// Asks the kernel to forget the file's pages, they are read from the disk again.
+static void dropPages(const std::string &path)
+{
+    const int fd = open(path.c_str(), O_RDONLY);
+    if(fd < 0)
+        return;
+    fdatasync(fd);
+    posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    close(fd);
+}
+
+// Maps every file and copies its blocks to the upload buffer, returns the seconds taken.
+static double load(const std::vector<std::string> &paths, const bool cold, const bool checkIndices, std::vector<char> &upload)
+{
+    if(cold)
+        for(unsigned c = 0; c < paths.size(); c++)
+            dropPages(paths[c]);
+
+    const double start = now();
+    for(unsigned c = 0; c < paths.size(); c++)
+    {
+        MeshFile file;
+        if(!file.open(paths[c], checkIndices))
+        {
+            std::cerr << paths[c] << ": " << file.error() << std::endl;
+            exit(1);
+        }
+        const size_t vertexBytes = sizeof(glm::vec3) * file.vertexDataSize();
+        const size_t indexBytes = sizeof(glm::ivec3) * file.numberOfIndices();
+        upload.resize(std::max(upload.size(), vertexBytes + indexBytes));
+        memcpy(upload.data(), file.vertexData(), vertexBytes);
+        memcpy(upload.data() + vertexBytes, file.indices(), indexBytes);
+    }
+    return now() - start;
+}
+
+int main(int argc, const char * argv[])
+{
+    std::vector<unsigned> dims;
+    for(int i = 1; i < argc; i++)
+        if(atoi(argv[i]) > 0)
+            dims.push_back(atoi(argv[i]));
+    if(dims.empty())
+    {
+        dims.push_back(100);
+        dims.push_back(200);
+    }
+
+    char directory[] = "/tmp/meshLoadBench.XXXXXX";
+    if(mkdtemp(directory) == NULL)
+    {
+        std::cerr << "Could not create a directory for the files" << std::endl;
+        return 1;
+    }
+
+    const float gridSize = 0.5, noiseScale = 0.1, isovalue = 0.55;
+    const unsigned cells = 4;
+    const int repetitions = 5;
+
+    std::cout << "Getting " << cells << " seamless cells into upload buffers, " << omp_get_max_threads() << " threads, ms per cell (best of "
+        << repetitions << ")" << std::endl;
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << "   dim  MB/cell  regenerate   cold map   warm map  warm map, no index check" << std::endl;
+
+    for(unsigned d = 0; d < dims.size(); d++)
+    {
+        const unsigned dim = dims[d];
+        std::vector<std::string> paths;
+        double regenerate = 1e30;
+        size_t bytes = 0;
+        for(int r = 0; r < repetitions; r++)
+        {
+            double total = 0.0;
+            for(unsigned c = 0; c < cells; c++)
+            {
+                VoxelData volume(dim, gridSize, glm::ivec3(c, 0, 0));
+                volume.setGenerationMode(VoxelData::GENERATE_BOUNDED, isovalue);
+                const double start = now();
+                volume.generateData(noiseScale);
+                volume.generateTriangles(isovalue);
+                total += now() - start;
+
+                if(r > 0)
+                    continue;
+                std::ostringstream path;
+                path << directory << "/cell_" << dim << "_" << c << ".mesh";
+                if(!MeshFile::write(path.str(), volume.getVertexData(), volume.getIndices()))
+                {
+                    std::cerr << "Could not write " << path.str() << std::endl;
+                    return 1;
+                }
+                paths.push_back(path.str());
+                bytes += sizeof(glm::vec3) * volume.getVertexData().size() + sizeof(glm::ivec3) * volume.getIndices().size();
+            }
+            regenerate = std::min(regenerate, total);
+        }
+
+        std::vector<char> upload;
+        double cold = 1e30, warm = 1e30, unchecked = 1e30;
+        for(int r = 0; r < repetitions; r++)
+        {
+            cold = std::min(cold, load(paths, true, true, upload));
+            warm = std::min(warm, load(paths, false, true, upload));
+            unchecked = std::min(unchecked, load(paths, false, false, upload));
+        }
+
+        std::cout << std::setw(6) << dim << std::setw(9) << bytes / (double)cells / (1024.0 * 1024.0)
+            << std::setw(12) << regenerate / cells * 1000.0 << std::setw(11) << cold / cells * 1000.0
+            << std::setw(11) << warm / cells * 1000.0 << std::setw(11) << unchecked / cells * 1000.0 << std::endl;
+
+        for(unsigned c = 0; c < paths.size(); c++)
+            unlink(paths[c].c_str());
+    }
+    rmdir(directory);
+    return 0;
+}
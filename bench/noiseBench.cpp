@@ -0,0 +1,109 @@
+// Throughput and accuracy of the batched simplex noise against snoise3, and of
+// filling a volume row by row with fbm3Row against the per-voxel octave loop
+// VoxelData::generateData used before.
+//
+// Run with ./bench/noiseBench [samples], defaults to 4 million.
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <cstdlib>
+#include <cstring>
+#include <math.h>
+
+#include "simplexnoise1234.h"
+#include "simplexnoisebatch.h"
+#include "benchclock.h"
+
+static void report(const char *name, const double seconds, const unsigned samples, const float maxError)
+{
+    std::cout << "  " << std::left << std::setw(20) << name << std::right << std::fixed << std::setprecision(2)
+    << std::setw(8) << seconds * 1e9 / samples << " ns/sample" << std::scientific << std::setprecision(2)
+    << "   max |error| " << maxError << std::endl;
+}
+
+int main(int argc, const char * argv[])
+{
+    const unsigned samples = (argc > 1 && atoi(argv[1]) > 0) ? atoi(argv[1]) : 4000000;
+
+    std::cout << "snoise3Batch uses: " << snoiseBatchImplementation() << std::endl;
+
+    // Random points in a range typical for the terrain octaves.
+    std::vector<float> x(samples), y(samples), z(samples), reference(samples), out(samples), outAVX2(samples);
+    srand(1234);
+    for(unsigned i = 0; i < samples; i++)
+    {
+        x[i] = (rand() / (float)RAND_MAX - 0.5f) * 64.0f;
+        y[i] = (rand() / (float)RAND_MAX - 0.5f) * 64.0f;
+        z[i] = (rand() / (float)RAND_MAX - 0.5f) * 64.0f;
+    }
+
+    std::cout << std::endl << "Noise, " << samples << " random points" << std::endl;
+
+    double t = now();
+    for(unsigned i = 0; i < samples; i++)
+        reference[i] = snoise3(x[i], y[i], z[i]);
+    report("snoise3", now() - t, samples, 0.0f);
+
+    t = now();
+    snoise3BatchScalar(&x[0], &y[0], &z[0], &out[0], samples);
+    double elapsed = now() - t;
+    float maxError = 0.0f;
+    for(unsigned i = 0; i < samples; i++)
+        maxError = std::max(maxError, fabsf(out[i] - reference[i]));
+    report("snoise3BatchScalar", elapsed, samples, maxError);
+
+    t = now();
+    snoise3BatchAVX2(&x[0], &y[0], &z[0], &outAVX2[0], samples);
+    elapsed = now() - t;
+    maxError = 0.0f;
+    for(unsigned i = 0; i < samples; i++)
+        maxError = std::max(maxError, fabsf(outAVX2[i] - reference[i]));
+    report("snoise3BatchAVX2", elapsed, samples, maxError);
+    std::cout << "  AVX2 and scalar batches " << (memcmp(&out[0], &outAVX2[0], samples * sizeof(float)) ? "differ" : "are bit-identical") << std::endl;
+
+    // A 100^3 cell with eight octaves, the default of main.
+    const unsigned dim = 100, n = dim + 1;
+    const float gridSize = 0.5f, noiseScale = 0.1f;
+    const unsigned voxels = n * n * n;
+    std::vector<float> volume(voxels), volumeRows(voxels);
+
+    std::cout << std::endl << "Volume fill, " << dim << "^3 cell, 8 octaves" << std::endl;
+
+    t = now();
+    for(unsigned i = 0; i < n; i++)
+        for(unsigned j = 0; j < n; j++)
+            for(unsigned k = 0; k < n; k++)
+            {
+                float value = (float)j / (float)n;
+                for(int octave = 0; octave < 8; octave++)
+                {
+                    const float s = (1.0f / (float)dim) * gridSize;
+                    const float f = noiseScale * (float)pow(2, octave);
+                    float noise = snoise3((i * s) * f, (j * s) * f, (k * s) * f) * 0.25 * (1.0 / (pow(2, octave)));
+                    value += noise;
+                }
+                volume[(i * n + j) * n + k] = value;
+            }
+    report("per-voxel snoise3", now() - t, voxels, 0.0f);
+
+    t = now();
+    const FbmOctaves fbm(8, noiseScale, 0.25f);
+    std::vector<float> rowZ(n);
+    for(unsigned k = 0; k < n; k++)
+        rowZ[k] = k * ((1.0f / (float)dim) * gridSize);
+    for(unsigned i = 0; i < n; i++)
+        for(unsigned j = 0; j < n; j++)
+        {
+            float *row = &volumeRows[(i * n + j) * n];
+            std::fill(row, row + n, (float)j / (float)n);
+            fbm3Row(fbm, i * ((1.0f / (float)dim) * gridSize), j * ((1.0f / (float)dim) * gridSize), &rowZ[0], row, n);
+        }
+    elapsed = now() - t;
+    maxError = 0.0f;
+    for(unsigned i = 0; i < voxels; i++)
+        maxError = std::max(maxError, fabsf(volumeRows[i] - volume[i]));
+    report("fbm3Row", elapsed, voxels, maxError);
+
+    return 0;
+}
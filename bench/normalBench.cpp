@@ -0,0 +1,78 @@
+// Times meshing with each normal estimator and measures how far the Sobel and
+// central difference normals are from the exact gradient of the noise field.
+//
+// Run with ./bench/normalBench [dim ...], defaults to 100 and 200.
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <cstdlib>
+
+#include "voxelData.h"
+#include "benchclock.h"
+
+int main(int argc, const char * argv[])
+{
+    std::vector<unsigned> dims;
+    for(int i = 1; i < argc; i++)
+        if(atoi(argv[i]) > 0)
+            dims.push_back(atoi(argv[i]));
+    if(dims.empty())
+    {
+        dims.push_back(100);
+        dims.push_back(200);
+    }
+
+    const char *names[] = {"sobel", "central", "analytic"};
+    const float gridSize = 0.5, noiseScale = 0.1, isovalue = 0.55;
+    const int repetitions = 5;
+
+    std::cout << "Meshing with each normal estimator (indexed, two-pass), " << omp_get_max_threads() << " threads" << std::endl;
+    std::cout << std::fixed;
+
+    for(unsigned d = 0; d < dims.size(); d++)
+    {
+        const unsigned dim = dims[d];
+        std::vector<glm::vec3> reference;
+
+        // Analytic first, so the others can be compared with it.
+        for(int m = VoxelData::NORMALS_ANALYTIC; m >= VoxelData::NORMALS_SOBEL; m--)
+        {
+            VoxelData volume(dim, gridSize);
+            volume.setNormalMode((VoxelData::NormalMode)m);
+            volume.generateData(noiseScale);
+
+            double best = 1e30;
+            for(int r = 0; r < repetitions; r++)
+            {
+                const double start = now();
+                volume.generateTriangles(isovalue);
+                best = std::min(best, now() - start);
+            }
+
+            const std::vector<glm::vec3> &vertices = volume.getVertexData();
+            if(m == VoxelData::NORMALS_ANALYTIC)
+                reference = vertices;
+
+            // Angle between this estimate and the exact normal.
+            double sumAngle = 0.0, maxAngle = 0.0;
+            for(unsigned i = 1; i < vertices.size(); i += 2)
+            {
+                const glm::dvec3 a = glm::normalize(glm::dvec3(vertices[i])), b = glm::normalize(glm::dvec3(reference[i]));
+                const double angle = acos(std::max(-1.0, std::min(1.0, glm::dot(a, b)))) * 180.0 / M_PI;
+                sumAngle += angle;
+                maxAngle = std::max(maxAngle, angle);
+            }
+
+            const unsigned numberOfVertices = volume.getNumberOfVertices();
+            std::cout << "  " << dim << "^3 " << std::setw(9) << names[m]
+                << std::setprecision(2) << std::setw(9) << best * 1000.0 << " ms"
+                << std::setw(9) << best * 1e9 / numberOfVertices << " ns/vertex"
+                << "   angle mean " << std::setprecision(3) << sumAngle / numberOfVertices
+                << " max " << std::setprecision(2) << maxAngle << " deg"
+                << "   peak " << volume.getPeakMeshingBytes() / 1048576.0 << " MB" << std::endl;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,371 @@
+// Benchmarks every stage of generating a cell: snoise3 throughput, generateData
+// in each generation mode, generateTriangles per isovalue, the normal estimators,
+// createVBO packing and a whole cell end to end. Each case is swept over 1, 2, 4, ... up to N OpenMP
+// threads and the results are written as JSON (in the layout of Google Benchmark,
+// so its compare tools work on them) for tracking regressions across versions.
+//
+// Run with ./bench/pipelineBench [--out file.json] [--threads N] [--filter text] [--label text] [--quick]
+// Progress goes to stderr, the JSON to stdout unless --out is given.
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <functional>
+#include <algorithm>
+#include <ctime>
+#include <cstdlib>
+#include <cstring>
+#include <math.h>
+#include <omp.h>
+
+#include "voxelData.h"
+#include "classify.h"
+#include "simplexnoise1234.h"
+#include "simplexnoisebatch.h"
+#include "benchclock.h"
+
+struct Counter
+{
+    std::string name;
+    double value;
+};
+
+struct Run
+{
+    std::string name;
+    unsigned threads;
+    std::vector<double> times;
+    std::vector<Counter> counters;
+};
+
+struct Options
+{
+    unsigned maxThreads;
+    std::string filter;
+    std::string label;
+    bool quick;
+};
+
+// Repeats a case until it has run for a while, at least a few times. The case
+// returns the seconds of the part it measures, so setup can stay out of the timing.
+static Run measure(const std::string &name, const unsigned threads, const Options &options, const std::function<double()> &run)
+{
+    const unsigned minIterations = options.quick ? 2 : 5, maxIterations = 1000;
+    const double minSeconds = options.quick ? 0.1 : 0.5;
+
+    Run result;
+    result.name = name;
+    result.threads = threads;
+
+    omp_set_num_threads(threads);
+    run();
+
+    const double start = now();
+    while(result.times.size() < minIterations || (now() - start < minSeconds && result.times.size() < maxIterations))
+        result.times.push_back(run() * 1000.0);
+
+    std::sort(result.times.begin(), result.times.end());
+    std::cerr << "  " << std::left << std::setw(40) << name << std::right << std::setw(3) << threads << " threads"
+        << std::fixed << std::setprecision(3) << std::setw(12) << result.times[result.times.size() / 2] << " ms" << std::endl;
+    return result;
+}
+
+static double median(const Run &run)
+{
+    return run.times[run.times.size() / 2];
+}
+
+static std::vector<unsigned> threadCounts(const unsigned maxThreads)
+{
+    std::vector<unsigned> counts;
+    for(unsigned t = 1; t < maxThreads; t *= 2)
+        counts.push_back(t);
+    counts.push_back(maxThreads);
+    return counts;
+}
+
+static bool selected(const std::string &name, const Options &options)
+{
+    return options.filter.empty() || name.find(options.filter) != std::string::npos;
+}
+
+static void benchNoise(const Options &options, std::vector<Run> &runs)
+{
+    const std::string name = "snoise3";
+    if(!selected(name, options))
+        return;
+
+    // Random points in a range typical for the terrain octaves.
+    const unsigned samples = options.quick ? 1000000 : 4000000;
+    std::vector<float> x(samples), y(samples), z(samples);
+    srand(1234);
+    for(unsigned i = 0; i < samples; i++)
+    {
+        x[i] = (rand() / (float)RAND_MAX - 0.5f) * 20.0f;
+        y[i] = (rand() / (float)RAND_MAX - 0.5f) * 20.0f;
+        z[i] = (rand() / (float)RAND_MAX - 0.5f) * 20.0f;
+    }
+
+    std::vector<unsigned> counts = threadCounts(options.maxThreads);
+    for(unsigned c = 0; c < counts.size(); c++)
+    {
+        float sink = 0.0f;
+        Run run = measure(name, counts[c], options, [&]
+        {
+            const double start = now();
+            float sum = 0.0f;
+            #pragma omp parallel for reduction(+:sum)
+            for(int i = 0; i < (int)samples; i++)
+                sum += snoise3(x[i], y[i], z[i]);
+            const double seconds = now() - start;
+            sink += sum;
+            return seconds;
+        });
+        run.counters.push_back(Counter{"items_per_second", samples / (median(run) / 1000.0)});
+        run.counters.push_back(Counter{"checksum", sink});
+        runs.push_back(run);
+    }
+}
+
+static void benchGenerateData(const Options &options, std::vector<Run> &runs)
+{
+    // Full keeps the plain name, so it compares with results from before the other modes.
+    const unsigned dims[] = {32, 100, 256};
+    const VoxelData::GenerationMode modes[] = {VoxelData::GENERATE_FULL, VoxelData::GENERATE_BOUNDED, VoxelData::GENERATE_TRUNCATED};
+    const char *modeNames[] = {"", "/bounded", "/truncated"};
+    std::vector<unsigned> counts = threadCounts(options.maxThreads);
+    for(unsigned d = 0; d < 3; d++)
+        for(unsigned m = 0; m < 3; m++)
+        {
+            std::ostringstream name;
+            name << "generateData/" << dims[d] << modeNames[m];
+            if(!selected(name.str(), options))
+                continue;
+
+            VoxelData volume(dims[d], 0.5f);
+            volume.setGenerationMode(modes[m], 0.55f);
+            for(unsigned c = 0; c < counts.size(); c++)
+            {
+                Run run = measure(name.str(), counts[c], options, [&]
+                {
+                    const double start = now();
+                    volume.generateData(0.1f);
+                    return now() - start;
+                });
+                const double samples = pow(dims[d] + 1.0, 3.0);
+                run.counters.push_back(Counter{"items_per_second", samples / (median(run) / 1000.0)});
+                run.counters.push_back(Counter{"noise_work", volume.getNoiseWork()});
+                runs.push_back(run);
+            }
+        }
+}
+
+static void benchGenerateTriangles(const Options &options, std::vector<Run> &runs)
+{
+    const unsigned dim = 100;
+    const float isovalues[] = {0.3f, 0.45f, 0.55f, 0.7f};
+    std::vector<unsigned> counts = threadCounts(options.maxThreads);
+
+    VoxelData volume(dim, 0.5f);
+    volume.generateData(0.1f);
+    for(unsigned i = 0; i < 4; i++)
+    {
+        std::ostringstream name;
+        name << "generateTriangles/" << dim << "/iso:" << isovalues[i];
+        if(!selected(name.str(), options))
+            continue;
+
+        for(unsigned c = 0; c < counts.size(); c++)
+        {
+            Run run = measure(name.str(), counts[c], options, [&]
+            {
+                const double start = now();
+                volume.generateTriangles(isovalues[i]);
+                return now() - start;
+            });
+            run.counters.push_back(Counter{"triangles", (double)volume.getNumberOfTriangles()});
+            run.counters.push_back(Counter{"vertices", (double)volume.getNumberOfVertices()});
+            run.counters.push_back(Counter{"skipped_brick_ratio", volume.getNumberOfSkippedBricks() / (double)volume.getNumberOfBricks()});
+            runs.push_back(run);
+        }
+    }
+}
+
+static void benchNormals(const Options &options, std::vector<Run> &runs)
+{
+    const unsigned dim = 100;
+    const char *names[] = {"sobel", "central", "analytic"};
+    std::vector<unsigned> counts = threadCounts(options.maxThreads);
+
+    VoxelData volume(dim, 0.5f);
+    volume.generateData(0.1f);
+    for(unsigned mode = VoxelData::NORMALS_SOBEL; mode <= VoxelData::NORMALS_ANALYTIC; mode++)
+    {
+        const std::string name = std::string("normals/") + names[mode];
+        if(!selected(name, options))
+            continue;
+
+        volume.setNormalMode((VoxelData::NormalMode)mode);
+        for(unsigned c = 0; c < counts.size(); c++)
+        {
+            // The whole meshing pass, since the normals are estimated as vertices are created.
+            double gradients = 0.0;
+            Run run = measure(name, counts[c], options, [&]
+            {
+                const double start = now();
+                volume.generateTriangles(0.55f);
+                gradients = volume.getMeshTimings().gradients;
+                return now() - start;
+            });
+            run.counters.push_back(Counter{"gradient_ms", gradients * 1000.0});
+            runs.push_back(run);
+        }
+    }
+}
+
+static void benchCreateVBO(const Options &options, std::vector<Run> &runs)
+{
+    const unsigned dim = 100;
+    const std::string name = "createVBO/100";
+    if(!selected(name, options))
+        return;
+
+    // Only the block strategy packs separate arrays, two-pass writes them interleaved.
+    VoxelData volume(dim, 0.5f);
+    volume.setMeshStrategy(VoxelData::MESH_BLOCKS);
+    volume.generateData(0.1f);
+    std::vector<unsigned> counts = threadCounts(options.maxThreads);
+    for(unsigned c = 0; c < counts.size(); c++)
+    {
+        Run run = measure(name, counts[c], options, [&]
+        {
+            volume.generateTriangles(0.55f);
+            return volume.getMeshTimings().packing;
+        });
+        run.counters.push_back(Counter{"bytes", 2.0 * sizeof(glm::vec3) * volume.getNumberOfVertices()});
+        runs.push_back(run);
+    }
+}
+
+static void benchCell(const Options &options, std::vector<Run> &runs)
+{
+    const unsigned dims[] = {32, 100};
+    std::vector<unsigned> counts = threadCounts(options.maxThreads);
+    for(unsigned d = 0; d < 2; d++)
+    {
+        std::ostringstream name;
+        name << "cell/" << dims[d];
+        if(!selected(name.str(), options))
+            continue;
+
+        for(unsigned c = 0; c < counts.size(); c++)
+        {
+            size_t peakBytes = 0;
+            Run run = measure(name.str(), counts[c], options, [&]
+            {
+                const double start = now();
+                VoxelData volume(dims[d], 0.5f, glm::vec3(0.5f, 0.0f, 0.0f));
+                volume.generateData(0.1f);
+                volume.generateTriangles(0.55f);
+                peakBytes = volume.getPeakMeshingBytes();
+                return now() - start;
+            });
+            run.counters.push_back(Counter{"cells_per_second", 1000.0 / median(run)});
+            run.counters.push_back(Counter{"peak_meshing_bytes", (double)peakBytes});
+            runs.push_back(run);
+        }
+    }
+}
+
+static void writeJSON(std::ostream &out, const std::vector<Run> &runs, const Options &options)
+{
+    char date[64];
+    const time_t t = time(NULL);
+    strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", localtime(&t));
+
+    out << std::setprecision(9);
+    out << "{\n  \"context\": {\n";
+    out << "    \"date\": \"" << date << "\",\n";
+    out << "    \"label\": \"" << options.label << "\",\n";
+    out << "    \"num_cpus\": " << omp_get_num_procs() << ",\n";
+    out << "    \"max_threads\": " << options.maxThreads << ",\n";
+    out << "    \"snoise_batch\": \"" << snoiseBatchImplementation() << "\",\n";
+    out << "    \"classify\": \"" << classifyImplementation() << "\",\n";
+    out << "    \"quick\": " << (options.quick ? "true" : "false") << "\n";
+    out << "  },\n  \"benchmarks\": [";
+    for(unsigned r = 0; r < runs.size(); r++)
+    {
+        const Run &run = runs[r];
+        double mean = 0.0;
+        for(unsigned i = 0; i < run.times.size(); i++)
+            mean += run.times[i] / run.times.size();
+
+        out << (r ? "," : "") << "\n    {\n";
+        out << "      \"name\": \"" << run.name << "/threads:" << run.threads << "\",\n";
+        out << "      \"run_name\": \"" << run.name << "\",\n";
+        out << "      \"threads\": " << run.threads << ",\n";
+        out << "      \"iterations\": " << run.times.size() << ",\n";
+        out << "      \"real_time\": " << median(run) << ",\n";
+        out << "      \"mean_time\": " << mean << ",\n";
+        out << "      \"min_time\": " << run.times.front() << ",\n";
+        out << "      \"max_time\": " << run.times.back() << ",\n";
+        for(unsigned c = 0; c < run.counters.size(); c++)
+            out << "      \"" << run.counters[c].name << "\": " << run.counters[c].value << ",\n";
+        out << "      \"time_unit\": \"ms\"\n    }";
+    }
+    out << "\n  ]\n}\n";
+}
+
+int main(int argc, const char * argv[])
+{
+    Options options;
+    options.maxThreads = omp_get_max_threads();
+    options.quick = false;
+    std::string outPath;
+
+    for(int i = 1; i < argc; i++)
+    {
+        if(!strcmp(argv[i], "--quick"))
+            options.quick = true;
+        else if(!strcmp(argv[i], "--out") && i + 1 < argc)
+            outPath = argv[++i];
+        else if(!strcmp(argv[i], "--threads") && i + 1 < argc && atoi(argv[i + 1]) > 0)
+            options.maxThreads = atoi(argv[++i]);
+        else if(!strcmp(argv[i], "--filter") && i + 1 < argc)
+            options.filter = argv[++i];
+        else if(!strcmp(argv[i], "--label") && i + 1 < argc)
+            options.label = argv[++i];
+        else
+        {
+            std::cerr << "Unknown argument " << argv[i] << std::endl;
+            return 1;
+        }
+    }
+
+    std::cerr << "Benchmarking the pipeline on 1 to " << options.maxThreads << " threads" << std::endl;
+
+    std::vector<Run> runs;
+    benchNoise(options, runs);
+    benchGenerateData(options, runs);
+    benchGenerateTriangles(options, runs);
+    benchNormals(options, runs);
+    benchCreateVBO(options, runs);
+    benchCell(options, runs);
+
+    if(outPath.empty())
+        writeJSON(std::cout, runs, options);
+    else
+    {
+        std::ofstream file(outPath.c_str());
+        writeJSON(file, runs, options);
+        if(!file)
+        {
+            std::cerr << "Could not write " << outPath << std::endl;
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,130 @@
+// Generates and meshes a seamless cell with its samples in every SampleVolume format
+// and measures the memory, the generation and meshing time, and how far the surface
+// moves against the float samples: where the grid edges cross the isovalue, edges
+// that no longer cross it (or newly do), and the vertex and triangle counts. Also
+// meshes the neighbouring cell and checks that the vertices on the shared border
+// still match exactly, which keeps the seam closed.
+//
+// Run with ./bench/sampleFormatBench [dim ...], defaults to 100 and 200.
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <set>
+#include <cstdlib>
+#include <cmath>
+
+#include "voxelData.h"
+#include "benchclock.h"
+
+typedef std::set<std::vector<float> > BorderVertices;
+
+// Vertices of a mesh on the plane x = gridSize / 2, the border of cells 0 and 1.
+static BorderVertices borderVertices(const VoxelData &volume, const float gridSize)
+{
+    BorderVertices border;
+    const std::vector<glm::vec3> &vertexData = volume.getVertexData();
+    for(size_t v = 0; v < vertexData.size() / 2; v++)
+        if(vertexData[2 * v].x == 0.5f * gridSize)
+            border.insert(std::vector<float>(&vertexData[2 * v].x, &vertexData[2 * v].x + 3));
+    return border;
+}
+
+int main(int argc, const char * argv[])
+{
+    std::vector<unsigned> dims;
+    for(int i = 1; i < argc; i++)
+        if(atoi(argv[i]) > 0)
+            dims.push_back(atoi(argv[i]));
+    if(dims.empty())
+    {
+        dims.push_back(100);
+        dims.push_back(200);
+    }
+
+    const float gridSize = 0.5, noiseScale = 0.1, isovalue = 0.55;
+    const int repetitions = 3;
+
+    std::cout << "Seamless cells of size " << gridSize << ", isovalue " << isovalue << ", crossings against the float samples" << std::endl;
+    std::cout << std::setprecision(3);
+
+    for(unsigned d = 0; d < dims.size(); d++)
+    {
+        const unsigned dim = dims[d];
+        VoxelData reference(dim, gridSize, glm::ivec3(0, 0, 0));
+        reference.generateData(noiseScale);
+        reference.generateTriangles(isovalue);
+        const SampleVolume &floats = reference.getSamples();
+
+        std::cout << "\ndim " << dim << std::endl;
+        std::cout << "   format  volume MB  generate ms  mesh ms  crossing max  mean (voxels)  flipped edges  vertices  triangles  border mismatches" << std::endl;
+
+        for(unsigned f = 0; f < SampleVolume::NUMBER_OF_FORMATS; f++)
+        {
+            const SampleVolume::Format format = (SampleVolume::Format)f;
+            VoxelData volume(dim, gridSize, glm::ivec3(0, 0, 0));
+            volume.setSampleFormat(format, isovalue);
+
+            double generate = 1e30, mesh = 1e30;
+            for(int r = 0; r < repetitions; r++)
+            {
+                double start = now();
+                volume.generateData(noiseScale);
+                generate = std::min(generate, now() - start);
+                start = now();
+                volume.generateTriangles(isovalue);
+                mesh = std::min(mesh, now() - start);
+            }
+
+            // Where each grid edge crosses the isovalue, as a share of the edge.
+            const SampleVolume &samples = volume.getSamples();
+            double maxCrossing = 0.0, sumCrossing = 0.0;
+            size_t crossings = 0, flipped = 0;
+            for(unsigned x = 0; x <= dim; x++)
+                for(unsigned y = 0; y <= dim; y++)
+                    for(unsigned z = 0; z <= dim; z++)
+                        for(unsigned axis = 0; axis < 3; axis++)
+                        {
+                            const unsigned x1 = x + (axis == 0), y1 = y + (axis == 1), z1 = z + (axis == 2);
+                            if(x1 > dim || y1 > dim || z1 > dim)
+                                continue;
+                            const float a = floats(x, y, z), b = floats(x1, y1, z1);
+                            const float qa = samples(x, y, z), qb = samples(x1, y1, z1);
+                            const bool crosses = (a > isovalue) != (b > isovalue);
+                            if(crosses != ((qa > isovalue) != (qb > isovalue)))
+                            {
+                                flipped++;
+                                continue;
+                            }
+                            if(!crosses)
+                                continue;
+                            const double error = fabs((isovalue - a) / (b - a) - (isovalue - qa) / (qb - qa));
+                            maxCrossing = std::max(maxCrossing, error);
+                            sumCrossing += error;
+                            crossings++;
+                        }
+
+            // The neighbour in the same format, and the vertices both put on the border.
+            VoxelData neighbour(dim, gridSize, glm::ivec3(1, 0, 0));
+            neighbour.setSampleFormat(format, isovalue);
+            neighbour.generateData(noiseScale);
+            neighbour.generateTriangles(isovalue);
+            const BorderVertices first = borderVertices(volume, gridSize), second = borderVertices(neighbour, gridSize);
+            unsigned mismatches = 0;
+            for(BorderVertices::const_iterator vertex = first.begin(); vertex != first.end(); ++vertex)
+                mismatches += second.count(*vertex) == 0;
+            for(BorderVertices::const_iterator vertex = second.begin(); vertex != second.end(); ++vertex)
+                mismatches += first.count(*vertex) == 0;
+
+            std::cout << std::setw(9) << SampleVolume::name(format) << std::setw(11) << samples.bytes() / (1024.0 * 1024.0)
+                << std::setw(13) << generate * 1000.0 << std::setw(9) << mesh * 1000.0
+                << std::setw(14) << maxCrossing << std::setw(15) << (crossings ? sumCrossing / crossings : 0.0)
+                << std::setw(15) << flipped
+                << std::setw(10) << volume.getNumberOfVertices() - reference.getNumberOfVertices()
+                << std::setw(11) << volume.getNumberOfTriangles() - reference.getNumberOfTriangles()
+                << std::setw(11) << mismatches << " of " << first.size() << std::endl;
+        }
+    }
+    std::cout << "\nVertices and triangles are counted against the float cell." << std::endl;
+    return 0;
+}
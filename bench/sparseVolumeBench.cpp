@@ -0,0 +1,87 @@
+// Generates and meshes a seamless cell with dense and with sparse samples, bounded
+// generation, and compares the memory held by the samples and while meshing, the
+// generation and meshing time, and whether the meshes are identical. The cell only
+// stores the bricks of samples near the surface, so its memory grows with the square
+// of the dim rather than the cube.
+//
+// Run with ./bench/sparseVolumeBench [format] [dim ...], format 0 float (the default)
+// to 3 unorm8, dims default to 128, 256 and 512. Dims above 600 only run sparse.
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <cstdlib>
+
+#include "voxelData.h"
+#include "benchclock.h"
+
+int main(int argc, const char * argv[])
+{
+    SampleVolume::Format format = SampleVolume::FORMAT_FLOAT;
+    std::vector<unsigned> dims;
+    for(int i = 1; i < argc; i++)
+    {
+        const int value = atoi(argv[i]);
+        if(i == 1 && value < (int)SampleVolume::NUMBER_OF_FORMATS)
+            format = (SampleVolume::Format)value;
+        else if(value > 0)
+            dims.push_back(value);
+    }
+    if(dims.empty())
+    {
+        dims.push_back(128);
+        dims.push_back(256);
+        dims.push_back(512);
+    }
+
+    const float gridSize = 0.5, noiseScale = 0.1, isovalue = 0.55;
+    const unsigned largestDense = 600;
+
+    std::cout << "Seamless cell of size " << gridSize << ", " << SampleVolume::name(format) << " samples, bounded generation" << std::endl;
+    std::cout << "   dim  storage  samples MB  peak meshing MB  stored bricks  generate s  mesh s  triangles  identical" << std::endl;
+    std::cout << std::setprecision(3);
+
+    for(unsigned d = 0; d < dims.size(); d++)
+    {
+        const unsigned dim = dims[d];
+        std::vector<glm::vec3> denseVertices;
+        std::vector<glm::ivec3> denseIndices;
+        for(unsigned s = dim > largestDense ? 1 : 0; s < 2; s++)
+        {
+            const SampleVolume::Storage storage = (SampleVolume::Storage)s;
+            VoxelData volume(dim, gridSize, glm::ivec3(0, 0, 0));
+            volume.setGenerationMode(VoxelData::GENERATE_BOUNDED, isovalue);
+            volume.setSampleFormat(format, isovalue, storage);
+
+            double start = now();
+            volume.generateData(noiseScale);
+            const double generate = now() - start;
+            start = now();
+            volume.generateTriangles(isovalue);
+            const double mesh = now() - start;
+
+            const SampleVolume &samples = volume.getSamples();
+            const size_t bricks = (size_t)samples.bricksX() * samples.bricksY() * samples.bricksZ();
+            std::cout << std::setw(6) << dim << std::setw(9) << (storage == SampleVolume::STORAGE_SPARSE ? "sparse" : "dense")
+                << std::setw(12) << samples.bytes() / (1024.0 * 1024.0)
+                << std::setw(17) << volume.getPeakMeshingBytes() / (1024.0 * 1024.0);
+            if(storage == SampleVolume::STORAGE_SPARSE)
+                std::cout << std::setw(13) << 100.0 * samples.storedBricks() / bricks << " %";
+            else
+                std::cout << std::setw(15) << "-";
+            std::cout << std::setw(12) << generate << std::setw(8) << mesh << std::setw(11) << volume.getNumberOfTriangles();
+
+            if(storage == SampleVolume::STORAGE_DENSE)
+            {
+                denseVertices = volume.getVertexData();
+                denseIndices = volume.getIndices();
+                std::cout << std::endl;
+            }
+            else if(dim > largestDense)
+                std::cout << std::setw(11) << "-" << std::endl;
+            else
+                std::cout << std::setw(11) << (volume.getVertexData() == denseVertices && volume.getIndices() == denseIndices ? "yes" : "no") << std::endl;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,117 @@
+// Packs the meshes of two neighbouring cells in every VertexFormat layout and
+// measures the size, the packing speed and how far the decoded positions and normals
+// are from the float ones. Also checks that the vertices on the shared border decode
+// to the same positions in both cells, which keeps the seam closed.
+//
+// Run with ./bench/vertexFormatBench [dim ...], defaults to 100 and 200.
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <map>
+#include <cstdlib>
+#include <cmath>
+
+#include "voxelData.h"
+#include "vertexformat.h"
+#include "benchclock.h"
+
+typedef std::map<std::vector<float>, glm::vec3> BorderVertices;
+
+int main(int argc, const char * argv[])
+{
+    std::vector<unsigned> dims;
+    for(int i = 1; i < argc; i++)
+        if(atoi(argv[i]) > 0)
+            dims.push_back(atoi(argv[i]));
+    if(dims.empty())
+    {
+        dims.push_back(100);
+        dims.push_back(200);
+    }
+
+    const float gridSize = 0.5, noiseScale = 0.1, isovalue = 0.55;
+    const float quantum = VertexFormat::quantum(gridSize);
+    const int repetitions = 5;
+
+    std::cout << "Two seamless cells of size " << gridSize << ", quantum " << quantum << ", errors against the float vertices" << std::endl;
+    std::cout << std::setprecision(3);
+
+    for(unsigned d = 0; d < dims.size(); d++)
+    {
+        const unsigned dim = dims[d];
+        const float voxel = gridSize / dim;
+        VoxelData first(dim, gridSize, glm::ivec3(0, 0, 0)), second(dim, gridSize, glm::ivec3(1, 0, 0));
+        first.generateData(noiseScale);
+        first.generateTriangles(isovalue);
+        second.generateData(noiseScale);
+        second.generateTriangles(isovalue);
+        const std::vector<glm::vec3> &vertexData = first.getVertexData();
+        const size_t numberOfVertices = vertexData.size() / 2;
+
+        std::cout << "\ndim " << dim << ", " << numberOfVertices << " vertices, voxel " << voxel << std::endl;
+        std::cout << "  layout  bytes  MB/cell  pack Mvert/s  position max  mean (voxels)  normal max  mean (degrees)  border mismatches" << std::endl;
+
+        for(unsigned l = 0; l < VertexFormat::NUMBER_OF_LAYOUTS; l++)
+        {
+            const VertexFormat::Layout layout = (VertexFormat::Layout)l;
+            std::vector<unsigned char> packed;
+            glm::vec4 origin;
+            double pack = 1e30;
+            for(int r = 0; r < repetitions; r++)
+            {
+                const double start = now();
+                origin = VertexFormat::pack(layout, vertexData.data(), numberOfVertices, quantum, packed);
+                pack = std::min(pack, now() - start);
+            }
+            std::vector<glm::vec3> decoded;
+            VertexFormat::unpack(layout, packed.data(), numberOfVertices, origin, decoded);
+
+            double maxPosition = 0.0, sumPosition = 0.0, maxAngle = 0.0, sumAngle = 0.0;
+            for(size_t v = 0; v < numberOfVertices; v++)
+            {
+                const double position = glm::distance(decoded[2 * v], vertexData[2 * v]);
+                // From the sine and cosine, acos alone loses small angles to rounding.
+                const glm::vec3 &normal = vertexData[2 * v + 1], &decodedNormal = decoded[2 * v + 1];
+                const double angle = atan2(glm::length(glm::cross(decodedNormal, normal)), glm::dot(decodedNormal, normal)) * 180.0 / M_PI;
+                maxPosition = std::max(maxPosition, position);
+                sumPosition += position;
+                maxAngle = std::max(maxAngle, angle);
+                sumAngle += angle;
+            }
+
+            // Vertices on the border between the cells, decoded by each cell. The cells
+            // are shifted by half their size, so the border is at x = gridSize / 2.
+            BorderVertices border[2];
+            const VoxelData *cells[2] = {&first, &second};
+            for(unsigned c = 0; c < 2; c++)
+            {
+                const std::vector<glm::vec3> &cellData = cells[c]->getVertexData();
+                std::vector<unsigned char> cellPacked;
+                std::vector<glm::vec3> cellDecoded;
+                const glm::vec4 cellOrigin = VertexFormat::pack(layout, cellData.data(), cellData.size() / 2, quantum, cellPacked);
+                VertexFormat::unpack(layout, cellPacked.data(), cellData.size() / 2, cellOrigin, cellDecoded);
+                for(size_t v = 0; v < cellData.size() / 2; v++)
+                    if(cellData[2 * v].x == 0.5f * gridSize)
+                        border[c][std::vector<float>(&cellData[2 * v].x, &cellData[2 * v].x + 3)] = cellDecoded[2 * v];
+            }
+            unsigned shared = 0, mismatches = 0;
+            for(BorderVertices::const_iterator vertex = border[0].begin(); vertex != border[0].end(); ++vertex)
+            {
+                BorderVertices::const_iterator other = border[1].find(vertex->first);
+                if(other == border[1].end())
+                    continue;
+                shared++;
+                if(other->second != vertex->second)
+                    mismatches++;
+            }
+
+            std::cout << std::setw(8) << VertexFormat::name(layout) << std::setw(7) << VertexFormat::vertexBytes(layout)
+                << std::setw(9) << packed.size() / (1024.0 * 1024.0) << std::setw(14) << numberOfVertices / pack / 1e6
+                << std::setw(14) << maxPosition / voxel << std::setw(15) << sumPosition / numberOfVertices / voxel
+                << std::setw(12) << maxAngle << std::setw(16) << sumAngle / numberOfVertices
+                << std::setw(11) << mismatches << " of " << shared << std::endl;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,189 @@
+// Compares the old triple-nested std::vector volume against VolumeGrid
+// for the access patterns of VoxelData: filling with noise, classifying
+// the cubes and gathering the 3x3x3 neighbourhoods used for normals.
+//
+// Run with ./bench/volumeBench [dim ...], defaults to 100 and 256.
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <cstdlib>
+#include <math.h>
+#include <omp.h>
+
+#include "volumegrid.h"
+#include "lookuptable.h"
+#include "simplexnoise1234.h"
+#include "benchclock.h"
+
+typedef std::vector<std::vector<std::vector<float>>> NestedVolume;
+
+// Same field as VoxelData::generateData for a cell centered at origo.
+static inline float sample(unsigned x, unsigned y, unsigned z, unsigned dim)
+{
+    const float gridSize = 0.5f, noiseScale = 0.1f;
+    float value = (float)y / (float)(dim + 1);
+    for(int octave = 0; octave < 8; octave++)
+    {
+        float s = gridSize / (float)dim * noiseScale * (float)pow(2, octave);
+        value += snoise3(x * s, y * s, z * s) * 0.25 * (1.0 / pow(2, octave));
+    }
+    return value;
+}
+
+static inline int clampIndex(int n, int upper)
+{
+    return n < 0 ? 0 : (n > upper ? upper : n);
+}
+
+struct Result
+{
+    double fill, classify, gather;
+    unsigned long long checksum;
+};
+
+static Result runNested(const unsigned dim, const float iso, const LookupTable &table)
+{
+    Result r;
+    double t = now();
+    NestedVolume data(dim + 1, std::vector<std::vector<float>>(dim + 1, std::vector<float>(dim + 1, 0.0f)));
+    #pragma omp parallel for
+    for(unsigned x = 0; x < dim + 1; x++)
+        for(unsigned y = 0; y < dim + 1; y++)
+            for(unsigned z = 0; z < dim + 1; z++)
+                data[x][y][z] = sample(x, y, z, dim);
+    r.fill = now() - t;
+
+    std::vector<unsigned char> cases(dim * dim * dim);
+    t = now();
+    #pragma omp parallel for
+    for(unsigned x = 0; x < dim; x++)
+        for(unsigned y = 0; y < dim; y++)
+            for(unsigned z = 0; z < dim; z++)
+            {
+                unsigned c = 0;
+                if (data[x][y][z] > iso) c |= 1;
+                if (data[x][y+1][z] > iso) c |= 2;
+                if (data[x+1][y+1][z] > iso) c |= 4;
+                if (data[x+1][y][z] > iso) c |= 8;
+                if (data[x][y][z+1] > iso) c |= 16;
+                if (data[x][y+1][z+1] > iso) c |= 32;
+                if (data[x+1][y+1][z+1] > iso) c |= 64;
+                if (data[x+1][y][z+1] > iso) c |= 128;
+                cases[(x * dim + y) * dim + z] = c;
+            }
+    r.classify = now() - t;
+
+    double sum = 0;
+    t = now();
+    #pragma omp parallel for reduction(+:sum)
+    for(unsigned x = 0; x < dim; x++)
+        for(unsigned y = 0; y < dim; y++)
+            for(unsigned z = 0; z < dim; z++)
+            {
+                unsigned c = cases[(x * dim + y) * dim + z];
+                if(table.triangleTable[c][0] == -1)
+                    continue;
+                for(int dx = -1; dx <= 1; dx++)
+                    for(int dy = -1; dy <= 1; dy++)
+                        for(int dz = -1; dz <= 1; dz++)
+                            sum += dy * data[clampIndex(x + dx, dim)][clampIndex(y + dy, dim)][clampIndex(z + dz, dim)];
+            }
+    r.gather = now() - t;
+    r.checksum = (unsigned long long)(sum * 1000.0);
+    return r;
+}
+
+static Result runFlat(const unsigned dim, const float iso, const LookupTable &table)
+{
+    Result r;
+    double t = now();
+    VolumeGrid<float> data(dim + 1, dim + 1, dim + 1);
+    #pragma omp parallel for
+    for(unsigned x = 0; x < dim + 1; x++)
+        for(unsigned y = 0; y < dim + 1; y++)
+        {
+            float *row = data.row(x, y);
+            for(unsigned z = 0; z < dim + 1; z++)
+                row[z] = sample(x, y, z, dim);
+        }
+    r.fill = now() - t;
+
+    std::vector<unsigned char> cases(dim * dim * dim);
+    t = now();
+    #pragma omp parallel for
+    for(unsigned x = 0; x < dim; x++)
+        for(unsigned y = 0; y < dim; y++)
+        {
+            const float *r00 = data.row(x, y);
+            const float *r01 = data.row(x, y + 1);
+            const float *r11 = data.row(x + 1, y + 1);
+            const float *r10 = data.row(x + 1, y);
+            for(unsigned z = 0; z < dim; z++)
+            {
+                unsigned c = 0;
+                if (r00[z] > iso) c |= 1;
+                if (r01[z] > iso) c |= 2;
+                if (r11[z] > iso) c |= 4;
+                if (r10[z] > iso) c |= 8;
+                if (r00[z+1] > iso) c |= 16;
+                if (r01[z+1] > iso) c |= 32;
+                if (r11[z+1] > iso) c |= 64;
+                if (r10[z+1] > iso) c |= 128;
+                cases[(x * dim + y) * dim + z] = c;
+            }
+        }
+    r.classify = now() - t;
+
+    double sum = 0;
+    t = now();
+    #pragma omp parallel for reduction(+:sum)
+    for(unsigned x = 0; x < dim; x++)
+        for(unsigned y = 0; y < dim; y++)
+            for(unsigned z = 0; z < dim; z++)
+            {
+                unsigned c = cases[(x * dim + y) * dim + z];
+                if(table.triangleTable[c][0] == -1)
+                    continue;
+                for(int dx = -1; dx <= 1; dx++)
+                    for(int dy = -1; dy <= 1; dy++)
+                        for(int dz = -1; dz <= 1; dz++)
+                            sum += dy * data(clampIndex(x + dx, dim), clampIndex(y + dy, dim), clampIndex(z + dz, dim));
+            }
+    r.gather = now() - t;
+    r.checksum = (unsigned long long)(sum * 1000.0);
+    return r;
+}
+
+static void print(const char *name, const Result &r)
+{
+    std::cout << "  " << std::left << std::setw(8) << name << std::right << std::fixed << std::setprecision(2)
+    << std::setw(10) << r.fill * 1000.0 << std::setw(12) << r.classify * 1000.0
+    << std::setw(10) << r.gather * 1000.0 << "   (checksum " << r.checksum << ")" << std::endl;
+}
+
+int main(int argc, const char * argv[])
+{
+    std::vector<unsigned> dims;
+    for(int i = 1; i < argc; i++)
+        if(atoi(argv[i]) > 0)
+            dims.push_back(atoi(argv[i]));
+    if(dims.empty())
+    {
+        dims.push_back(100);
+        dims.push_back(256);
+    }
+
+    LookupTable table;
+    const float isovalue = 0.55;
+
+    std::cout << "Threads: " << omp_get_max_threads() << std::endl;
+    for(unsigned i = 0; i < dims.size(); i++)
+    {
+        std::cout << std::endl << "Grid " << dims[i] << "^3, times in ms" << std::endl;
+        std::cout << "  layout        fill    classify    gather" << std::endl;
+        print("nested", runNested(dims[i], isovalue, table));
+        print("flat", runFlat(dims[i], isovalue, table));
+    }
+    return 0;
+}
@@ -0,0 +1,9 @@
+#pragma once
+
+#include <chrono>
+
+// Seconds on a steady clock, for timing the benchmarks and tools.
+inline double now()
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
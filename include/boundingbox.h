@@ -0,0 +1,30 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+
+#include "glm/glm.hpp"
+
+// Wireframe cube around a terrain cell, drawn with GL_LINES for debugging.
+class BoundingBox
+{
+public:
+
+    BoundingBox(const glm::vec3 &center, const float size);
+    ~BoundingBox();
+
+    // Owns its GL objects, so it moves but does not copy.
+    BoundingBox(BoundingBox &&other);
+    BoundingBox &operator=(BoundingBox &&other);
+
+    void draw() const;
+
+private:
+
+    BoundingBox(const BoundingBox &) = delete;
+    BoundingBox &operator=(const BoundingBox &) = delete;
+
+    void release();
+
+    GLuint _VAO, _VBO, _EBO;
+};
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+
+#include "samplevolume.h"
+
+// Min/max pyramid over the samples of a volume. Level 0 holds the range of every
+// brick of BRICK^3 cubes (including the samples on its upper faces, which it
+// shares with the next brick), every level above merges 2x2x2 nodes of the one
+// below, up to a single root. A brick whose range does not straddle the isovalue
+// is entirely inside or outside, so none of its cubes or edges hold the surface.
+class BrickPyramid
+{
+public:
+
+    static const unsigned BRICK = 8;
+
+    // Summarise data, which holds (dim + 1)^3 samples.
+    void build(const SampleVolume &data, const unsigned dim);
+    void clear() { _levels.clear(); };
+    bool empty() const { return _levels.empty(); };
+
+    // Bricks along each axis of the volume.
+    unsigned bricksPerAxis() const { return _levels.empty() ? 0 : _levels[0].size; };
+
+    // Mark the bricks with a sample above and a sample at or below the isovalue (the
+    // same test classifyCubes makes), indexed (x * n + y) * n + z for n bricks per axis.
+    // Only the children of straddling nodes are visited, so the cost follows the
+    // surface rather than the volume. Returns the number of marked bricks.
+    unsigned findActive(const float isovalue, std::vector<unsigned char> &active) const;
+
+    size_t bytes() const;
+
+private:
+
+    struct Level
+    {
+        unsigned size;
+        std::vector<float> min, max;
+
+        size_t index(const unsigned x, const unsigned y, const unsigned z) const { return ((size_t)x * size + y) * size + z; };
+    };
+
+    std::vector<Level> _levels;
+};
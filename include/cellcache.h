@@ -0,0 +1,96 @@
+#pragma once
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstddef>
+#include <stdint.h>
+
+#include <glm/glm.hpp>
+
+#include "voxelData.h"
+#include "meshfile.h"
+
+// Keeps the meshes of generated cells in a directory, so a later run with the same
+// parameters maps them instead of generating them again. Each cell is one MeshFile
+// named after a hash of everything its mesh depends on, with the whole key as its tag
+// to tell hash collisions apart. The files are written whole and renamed into place,
+// so several jobs and runs can share the directory. When the files add up to more
+// than the size limit, the ones used longest ago are deleted.
+class CellCache
+{
+public:
+
+    // Everything a cell's mesh depends on. Plain 32-bit fields without padding, hashed
+    // and compared as bytes.
+    struct Key
+    {
+        Key();
+        Key(const VoxelData &volume, const float noiseScale, const float isovalue);
+
+        float gridCenter[3];
+        float gridSize;
+        uint32_t dim;
+        uint32_t seamless;
+        uint32_t neighbourDimensions[4];
+        uint32_t cornerDimensions[4];
+        float noiseScale;
+        float isovalue;
+        uint32_t generationMode;
+        uint32_t meshMode;
+        uint32_t meshStrategy;
+        uint32_t normalMode;
+        uint32_t sampleFormat;
+        uint32_t generatorVersion;
+    };
+
+    // 64-bit FNV-1a of the key.
+    static uint64_t hash(const Key &key);
+
+    struct Stats
+    {
+        unsigned hits, misses, stores, evictions;
+        size_t bytesRead, bytesWritten;
+
+        // Bytes of all files in the directory.
+        size_t bytesStored;
+    };
+
+    // The directory must exist. It is scanned for the files of earlier runs.
+    CellCache(const std::string &directory, const size_t maxBytes);
+
+    // Maps the cell's mesh, or returns an empty pointer if it is not cached.
+    std::unique_ptr<MeshFile> load(const Key &key);
+
+    // Writes a mesh, then deletes the least recently used files over the limit.
+    bool store(const Key &key, const std::vector<glm::vec3> &vertexData, const std::vector<glm::ivec3> &indices);
+
+    Stats stats() const;
+
+private:
+
+    CellCache(const CellCache &) = delete;
+    CellCache &operator=(const CellCache &) = delete;
+
+    std::string path(const uint64_t hash) const;
+    void forget(const uint64_t hash);
+    void evict(const uint64_t keep);
+
+    const std::string _directory;
+    const size_t _maxBytes;
+
+    // The files in the directory, with their size and when they were last used.
+    struct Entry
+    {
+        size_t bytes;
+        uint64_t lastUse;
+    };
+    std::map<uint64_t, Entry> _entries;
+    uint64_t _clock;
+    unsigned _temporaryFiles;
+
+    Stats _stats;
+    mutable std::mutex _mutex;
+};
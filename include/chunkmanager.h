@@ -0,0 +1,126 @@
+#pragma once
+
+#include <map>
+#include <set>
+#include <vector>
+#include <array>
+#include <memory>
+#include <utility>
+#include <mutex>
+#include <condition_variable>
+
+#include "voxelData.h"
+#include "terrainarena.h"
+#include "timingstats.h"
+#include "jobpool.h"
+#include "cellcache.h"
+
+// Streams terrain cells around the camera for an endless world. Cells of the
+// ground grid within the view radius are generated as jobs on the pool, nearest
+// first, and handed back through a completion queue that the GL thread empties a
+// few cells per frame into the arena. Cells that fall out of range are evicted.
+class ChunkManager
+{
+public:
+
+    struct Settings
+    {
+        Settings();
+
+        unsigned dim;
+        float gridSize;
+        float noiseScale;
+        float isovalue;
+        VoxelData::MeshMode meshMode;
+        VoxelData::NormalMode normalMode;
+        VoxelData::GenerationMode generationMode;
+        SampleVolume::Format sampleFormat;
+        SampleVolume::Storage sampleStorage;
+
+        // Cells with their center within viewRadius of the camera (measured in the
+        // ground plane) are loaded, and kept until they are a cell further away.
+        float viewRadius;
+
+        // Hard limits on the resident cells and the memory they use, the arena
+        // memory plus the border slabs kept for their neighbours.
+        unsigned maxChunks;
+        size_t maxGPUBytes;
+
+        // Finished cells uploaded per frame, and cells queued for generation at once.
+        unsigned uploadsPerFrame;
+        unsigned maxInFlight;
+
+        // Meshes kept from earlier runs and stored for later ones, none if NULL.
+        CellCache *cache;
+    };
+
+    ChunkManager(TerrainArena &arena, JobPool &pool, const Settings &settings);
+    ~ChunkManager();
+
+    // Request, upload and evict the cells within viewRadius of center, the point on the
+    // ground the camera looks at. Missing cells are requested nearest to the eye first.
+    // Call once per frame on the GL thread, it never waits for generation.
+    void update(const glm::vec3 &center, const glm::vec3 &eye);
+
+    unsigned residentChunks() const { return _resident.size(); };
+    unsigned pendingChunks() const { return _inFlight.size(); };
+
+    // Milliseconds from requesting a cell until it is in the arena.
+    const TimingStats &loadLatency() const { return _latency; };
+
+private:
+
+    // Position of a cell on the ground grid, its center is gridSize * (i, 0, j).
+    typedef std::pair<int, int> ChunkKey;
+
+    struct Result
+    {
+        ChunkKey key;
+        double requestTime;
+        std::vector<glm::vec3> vertexData;
+        std::vector<glm::ivec3> indices;
+
+        // The mesh mapped from the cache instead, if it was there.
+        std::unique_ptr<MeshFile> mapped;
+    };
+
+    ChunkManager(const ChunkManager &) = delete;
+    ChunkManager &operator=(const ChunkManager &) = delete;
+
+    void generate(const ChunkKey key, const double requestTime);
+    void forgetBorders(const ChunkKey &key);
+    size_t borderBytes();
+
+    float distance(const ChunkKey &key, const glm::vec3 &center) const;
+    bool evictFarthest(const glm::vec3 &center, const float nearerThan);
+
+    TerrainArena &_arena;
+    JobPool &_pool;
+    const Settings _settings;
+
+    // Cells in the arena, and cells requested but not uploaded yet.
+    std::map<ChunkKey, unsigned> _resident;
+    std::set<ChunkKey> _inFlight;
+
+    // Cells that did not fit the memory budget, retried when the center enters another cell.
+    std::set<ChunkKey> _skipped;
+    ChunkKey _centerChunk;
+
+    TimingStats _latency;
+
+    CompletionQueue<Result> _results;
+
+    // Shared with the jobs. Cancelled cells went out of range before their job started.
+    std::mutex _mutex;
+    std::condition_variable _jobsDone;
+    std::set<ChunkKey> _cancelled;
+
+    // The samples every generated cell shares with its neighbours, one slab per face,
+    // so a neighbour generated later copies them instead of evaluating them again.
+    // Dropped with the cell, and counted in maxGPUBytes.
+    typedef std::array<std::shared_ptr<const std::vector<float> >, 4> BorderSlabs;
+    std::map<ChunkKey, BorderSlabs> _borders;
+    size_t _borderBytes;
+    unsigned _jobs;
+    bool _quit;
+};
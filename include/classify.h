@@ -0,0 +1,30 @@
+#pragma once
+
+// Marching cubes classification of a row of cubes along z.
+//
+// The cubes between z and z + 1 have their corners in four z-rows: r00 = (x, y),
+// r01 = (x, y + 1), r11 = (x + 1, y + 1) and r10 = (x + 1, y), each holding
+// count + 1 samples. cases[z] receives the cube's case index (0-255) in the bit
+// order of LookupTable::triangleTable, and the z of every cube that is neither
+// fully inside (255) nor fully outside (0) is appended to active. Returns the
+// number of active cubes.
+//
+// classifyCubes picks the widest implementation the CPU supports the first time
+// it is called, the others are available for testing and benchmarking.
+
+unsigned classifyCubes(const float *r00, const float *r01, const float *r11, const float *r10,
+    const unsigned count, const float isovalue, unsigned char *cases, unsigned *active);
+
+unsigned classifyCubesScalar(const float *r00, const float *r01, const float *r11, const float *r10,
+    const unsigned count, const float isovalue, unsigned char *cases, unsigned *active);
+unsigned classifyCubesSSE41(const float *r00, const float *r01, const float *r11, const float *r10,
+    const unsigned count, const float isovalue, unsigned char *cases, unsigned *active);
+unsigned classifyCubesAVX2(const float *r00, const float *r01, const float *r11, const float *r10,
+    const unsigned count, const float isovalue, unsigned char *cases, unsigned *active);
+
+// Whether the CPU can run the SSE4.1 and AVX2 versions.
+bool classifySupportsSSE41();
+bool classifySupportsAVX2();
+
+// Name of the implementation classifyCubes uses ("avx2", "sse4.1" or "scalar").
+const char *classifyImplementation();
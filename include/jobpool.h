@@ -0,0 +1,126 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <memory>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+// Takes the lock, counting it in contended when another thread already held it.
+template <typename Mutex>
+inline std::unique_lock<Mutex> lockCounted(Mutex &mutex, std::atomic<unsigned> &contended)
+{
+    std::unique_lock<Mutex> lock(mutex, std::try_to_lock);
+    if(!lock.owns_lock())
+    {
+        contended++;
+        lock.lock();
+    }
+    return lock;
+}
+
+// A pool of worker threads for independent jobs such as generating cells. Every
+// worker has a queue of its own and takes its newest job first, a worker that runs
+// out steals the oldest job of another one. OpenMP is limited to one thread inside
+// the workers, the parallelism comes from running many jobs at once.
+class JobPool
+{
+public:
+
+    typedef std::function<void()> Job;
+
+    // threads = 0 uses one worker per hardware thread.
+    JobPool(unsigned threads = 0);
+
+    // Waits for the running jobs, jobs that have not started are dropped.
+    ~JobPool();
+
+    // Can be called from any thread, jobs submitted by a worker go to its own queue.
+    void submit(const Job &job);
+
+    // Block until every submitted job has finished.
+    void wait();
+
+    unsigned size() const { return _threads.size(); };
+
+    // Times a thread had to wait for a queue lock held by another.
+    unsigned contention() const { return _contended; };
+
+private:
+
+    struct Worker
+    {
+        std::mutex mutex;
+        std::deque<Job> jobs;
+    };
+
+    JobPool(const JobPool &) = delete;
+    JobPool &operator=(const JobPool &) = delete;
+
+    void run(const unsigned index);
+    bool pop(const unsigned index, Job &job);
+
+    std::vector<std::unique_ptr<Worker> > _workers;
+    std::vector<std::thread> _threads;
+
+    std::mutex _mutex;
+    std::condition_variable _wake;
+    std::condition_variable _idle;
+    std::atomic<int> _queued;
+    std::atomic<int> _unfinished;
+    std::atomic<unsigned> _nextWorker;
+    std::atomic<unsigned> _contended;
+    bool _quit;
+};
+
+// Hands finished work from the workers to one consumer, typically the GL thread
+// uploading meshes.
+template <typename T>
+class CompletionQueue
+{
+public:
+
+    CompletionQueue() : _contended(0) {};
+
+    void push(T &&item)
+    {
+        {
+            std::unique_lock<std::mutex> lock = lockCounted(_mutex, _contended);
+            _items.push_back(std::move(item));
+        }
+        _ready.notify_one();
+    };
+
+    // Take the oldest item if there is one.
+    bool tryPop(T &item)
+    {
+        std::unique_lock<std::mutex> lock = lockCounted(_mutex, _contended);
+        if(_items.empty())
+            return false;
+        item = std::move(_items.front());
+        _items.pop_front();
+        return true;
+    };
+
+    // Take the oldest item, waiting for one if needed.
+    void waitPop(T &item)
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _ready.wait(lock, [this] { return !_items.empty(); });
+        item = std::move(_items.front());
+        _items.pop_front();
+    };
+
+    // Times a thread had to wait for the lock held by another.
+    unsigned contention() const { return _contended; };
+
+private:
+
+    std::mutex _mutex;
+    std::condition_variable _ready;
+    std::deque<T> _items;
+    std::atomic<unsigned> _contended;
+};
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+
+#include <glm/glm.hpp>
+
+// Picks the level of detail of every cell of the fixed grid from how large its sample
+// spacing appears on screen. Level l has dim >> l samples per side. Cells switch to
+// a finer level as soon as their error is too large, but to a coarser one only when
+// that level is well below it, so a camera resting near a threshold does not make them
+// flip back and forth. A triangle budget and a target frame time trade detail for speed
+// by raising the error allowed. No GL, the caller re-meshes the cells it is handed.
+class LodScheduler
+{
+public:
+
+    struct Settings
+    {
+        Settings();
+
+        // The finest cells and the number of levels, at most as many as halve dim evenly
+        // and keep 4 samples per side.
+        unsigned dim;
+        float gridSize;
+        unsigned levels;
+
+        // Pixels per world unit at distance 1, the projection's y scale times half the
+        // viewport height.
+        float focalLength;
+
+        // Largest spacing of the samples on screen, in pixels. A coarser level is taken
+        // only when its spacing is below hysteresis times that.
+        float pixelError;
+        float hysteresis;
+
+        // Triangles of all cells together, 0 for no limit.
+        size_t triangleBudget;
+
+        // Frame time to keep to in milliseconds, 0 for none. Slower frames raise the
+        // error allowed, up to maxErrorScale times pixelError, and faster ones lower it.
+        double targetFrameMs;
+        float maxErrorScale;
+    };
+
+    // The cells are (i, j) with |i|, |j| <= cellGrid / 2, numbered (i + cellGrid / 2) *
+    // side + j + cellGrid / 2 like the viewer's cells.
+    LodScheduler(const Settings &settings, const int cellGrid);
+
+    unsigned levels() const { return _levels; };
+    unsigned numberOfCells() const { return _level.size(); };
+    glm::ivec2 cellPosition(const unsigned cell) const;
+    unsigned dimension(const unsigned cell) const { return _settings.dim >> _level[cell]; };
+
+    // The dim of the neighbour across face (the order of VoxelData::Face), 0 if it is
+    // outside the grid.
+    unsigned neighbourDimension(const unsigned cell, const unsigned face) const;
+
+    // The dim of the neighbour across the corner of an x-face and a z-face, 0 if it is
+    // outside the grid.
+    unsigned cornerDimension(const unsigned cell, const unsigned xFace, const unsigned zFace) const;
+
+    // The triangles a cell got at its current level, which scale the estimates for the others.
+    void reportTriangles(const unsigned cell, const unsigned triangles);
+
+    // Chooses the levels for the camera and the last frame time (0 if unknown). Returns
+    // true if any changed, with the cells to re-mesh: those that changed and the ones
+    // around them, corners included, whose borders follow their neighbours. Neighbours, corners included,
+    // are never more than one level apart, and a cell across a corner is never coarser
+    // than both cells beside it.
+    bool update(const glm::vec3 &camera, const double frameMs, std::vector<unsigned> &remesh);
+
+    // The error allowed after the frame time feedback, and the estimated triangles of the levels.
+    float currentPixelError() const { return _settings.pixelError * _errorScale; };
+    size_t estimatedTriangles() const;
+
+private:
+
+    float projectedError(const unsigned cell, const unsigned level, const glm::vec3 &camera) const;
+    size_t estimateTriangles(const unsigned cell, const unsigned level) const;
+
+    // The levels for the error allowed, starting from the current ones, with the
+    // neighbour rules of update applied.
+    void chooseLevels(const glm::vec3 &camera, const float allowed, std::vector<unsigned> &levels) const;
+
+    const Settings _settings;
+    const int _half;
+    const int _side;
+    unsigned _levels;
+
+    // The levels in use, and the triangles a cell had at the level it was measured at.
+    std::vector<unsigned> _level;
+    std::vector<unsigned> _triangles;
+    std::vector<unsigned> _measuredLevel;
+
+    float _errorScale;
+    double _frameMs;
+};
@@ -1,9 +1,22 @@
+#pragma once
+
 #include <vector>
 
 class LookupTable
 {
 public:
-    LookupTable(){};
+    LookupTable()
+    {
+        // Count the triangles of each case once, so meshing can size its output up front.
+        for(unsigned c = 0; c < 256; c++)
+        {
+            triangleCount[c] = 0;
+            while(triangleCount[c] < 5 && triangleTable[c][3 * triangleCount[c]] != -1)
+                triangleCount[c]++;
+        }
+    };
+
+    unsigned char triangleCount[256];
 
     // A function to return the right edges when given a case 0-255.
     //const std::vector<std::vector<unsigned>> &lookup(const unsigned n) const { return cases.at(n); };
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <stdint.h>
+
+#include <glm/glm.hpp>
+
+// A cell's mesh in a file laid out to be used in place: a header, a small tag the
+// writer can fill with anything (the cache keeps its key there), the interleaved
+// vertex block like VoxelData::getVertexData and the triangle index block. Every block
+// starts on a multiple of MeshFile::ALIGNMENT bytes, so once the file is mapped the
+// blocks can be handed to the GL without copying them first. The header also holds
+// the bounding box of the positions. All values are little-endian.
+class MeshFile
+{
+public:
+
+    static const uint32_t VERSION = 1;
+    static const size_t ALIGNMENT = 64;
+
+    struct Header
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t headerBytes;
+
+        // Bytes per vertex (a position and a normal) and per triangle.
+        uint32_t vertexBytes;
+        uint32_t triangleBytes;
+
+        uint64_t tagOffset, tagBytes;
+        uint64_t vertexOffset, numberOfVertices;
+        uint64_t indexOffset, numberOfTriangles;
+
+        float boundsMin[3];
+        float boundsMax[3];
+
+        // Bytes in the whole file.
+        uint64_t fileBytes;
+    };
+
+    // Writes vertexData (a position and a normal per vertex) and its triangles to path.
+    // Returns false if the file could not be written whole.
+    static bool write(const std::string &path, const std::vector<glm::vec3> &vertexData, const std::vector<glm::ivec3> &indices,
+        const void *tag = NULL, const size_t tagBytes = 0);
+
+    MeshFile();
+    ~MeshFile();
+
+    // Maps the file and checks that it is a whole mesh file of this version, with every
+    // block inside it. With checkIndices, every index must also name one of its
+    // vertices, which reads the index block once. Returns false and sets error() if not.
+    bool open(const std::string &path, const bool checkIndices = true);
+    void close();
+    const std::string &error() const { return _error; };
+
+    // Interleaved positions and normals, two vec3 per vertex, and the triangles.
+    const glm::vec3 *vertexData() const { return _vertexData; };
+    size_t vertexDataSize() const { return _header ? 2 * _header->numberOfVertices : 0; };
+    const glm::ivec3 *indices() const { return _indices; };
+    size_t numberOfIndices() const { return _header ? _header->numberOfTriangles : 0; };
+
+    glm::vec3 boundsMin() const;
+    glm::vec3 boundsMax() const;
+
+    const void *tag() const { return _tag; };
+    size_t tagBytes() const { return _header ? _header->tagBytes : 0; };
+
+    // Bytes of the mapping.
+    size_t bytes() const { return _length; };
+
+private:
+
+    MeshFile(const MeshFile &) = delete;
+    MeshFile &operator=(const MeshFile &) = delete;
+
+    bool fail(const std::string &error);
+
+    void *_address;
+    size_t _length;
+    const Header *_header;
+    const void *_tag;
+    const glm::vec3 *_vertexData;
+    const glm::ivec3 *_indices;
+    std::string _error;
+};
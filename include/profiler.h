@@ -0,0 +1,61 @@
+#pragma once
+
+#include <atomic>
+#include <string>
+
+// Records scoped timings and counter samples, and exports them as Chrome trace
+// events (load the file in chrome://tracing or ui.perfetto.dev). Every thread
+// records into a buffer of its own. While disabled a scope costs one relaxed load
+// and a branch, and building with -DNO_PROFILING removes the macros altogether.
+//
+// Names must be string literals, only the pointer is kept.
+class Profiler
+{
+public:
+
+    static void setEnabled(const bool enabled);
+    static bool enabled() { return _enabled.load(std::memory_order_relaxed); };
+
+    // Name the calling thread in the trace, e.g. "worker 2".
+    static void setThreadName(const std::string &name);
+
+    // Record a sample of a counter, shown as a graph over time.
+    static void counter(const char *name, const double value);
+
+    // Write everything recorded so far. Call it when the threads are idle.
+    static bool writeTrace(const std::string &path);
+    static void clear();
+
+    // Times the enclosing block, see PROFILE_SCOPE.
+    class Scope
+    {
+    public:
+        Scope(const char *name) : _name(enabled() ? name : NULL), _start(_name ? now() : 0.0) {};
+        ~Scope() { if(_name) complete(_name, _start, now()); };
+
+    private:
+        Scope(const Scope &) = delete;
+        Scope &operator=(const Scope &) = delete;
+
+        const char *_name;
+        const double _start;
+    };
+
+private:
+
+    // Microseconds since the program started.
+    static double now();
+    static void complete(const char *name, const double start, const double end);
+
+    static std::atomic<bool> _enabled;
+};
+
+#ifdef NO_PROFILING
+#define PROFILE_SCOPE(name)
+#define PROFILE_COUNTER(name, value)
+#else
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+#define PROFILE_SCOPE(name) Profiler::Scope PROFILE_CONCAT(profileScope, __LINE__)(name)
+#define PROFILE_COUNTER(name, value) do { if(Profiler::enabled()) Profiler::counter(name, value); } while(0)
+#endif
@@ -2,6 +2,7 @@
 #include<iostream>
 #include <GLFW/glfw3.h>
 #include <cmath>
+#include "glm/glm.hpp"
 
 #ifndef M_PI
 #define M_PI (3.141592653589793)
@@ -30,6 +31,10 @@ public:
 	float transY;
 	float zoom;
 
+	// Point the camera looks at. WASD moves it over the ground, shift moves faster.
+	glm::vec3 target;
+	float speed;
+
 private:
 	double lastX;
 	double lastY;
@@ -37,8 +42,12 @@ private:
 	int lastRight;
 	int lastMiddle;
 	bool rotStarted;
+	double lastTime;
 
 public:
 	void init(GLFWwindow *window);
 	void poll(GLFWwindow *window);
+
+	// Camera position in world space, as used for the view matrix.
+	glm::vec3 cameraPosition() const;
 };
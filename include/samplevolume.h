@@ -0,0 +1,156 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+#include <stdint.h>
+
+#include "volumegrid.h"
+
+// The samples of a VoxelData volume, laid out like a VolumeGrid<float> but stored in
+// one of several formats, and always read and written as floats.
+//
+// Half stores each sample as an IEEE half float. Unorm16 and unorm8 store where the
+// sample lies on a curve that is finest around a center value and coarsens away from
+// it: the code is linear in g = d / (|d| + width), with d the distance from the
+// center, so a step near the center is about 2 * width / 2^bits and the steps have
+// doubled at distance width / 2. Every value has a code, and a sample above the
+// center never reads back at or below it, so classifying against the center is exact.
+// In every format, storing a value read back gives the same code again.
+//
+// Sparse volumes split the samples into bricks of BRICK^3, counted from sample -apron,
+// and only store the bricks setBricks asks for. Every other brick reads as a single
+// value, so a volume whose bricks away from the surface are constant takes memory in
+// proportion to the surface instead of the volume.
+//
+// Rows of a sparse volume or of another format than float are assembled in a small
+// ring of buffers owned by the calling thread. A row pointer stays valid until that
+// thread has read ROW_BUFFERS - 1 more rows, or a row of a volume with longer rows.
+class SampleVolume
+{
+public:
+
+    enum Format { FORMAT_FLOAT, FORMAT_HALF, FORMAT_UNORM16, FORMAT_UNORM8 };
+    static const unsigned NUMBER_OF_FORMATS = 4;
+    enum Storage { STORAGE_DENSE, STORAGE_SPARSE };
+    static const unsigned ROW_BUFFERS = 8;
+    static const unsigned BRICK = 8;
+    static const unsigned BRICK_SAMPLES = BRICK * BRICK * BRICK;
+
+    static const char *name(const Format format);
+    static size_t sampleBytes(const Format format);
+
+    SampleVolume();
+
+    // Allocates the volume like VolumeGrid::resize, with every sample at center. The
+    // center and width only matter to the unorm formats. A sparse volume starts out
+    // with no bricks stored.
+    void resize(const unsigned nx, const unsigned ny, const unsigned nz, const unsigned apron,
+        const Format format = FORMAT_FLOAT, const float center = 0.0f, const float width = 1.0f,
+        const Storage storage = STORAGE_DENSE);
+    void release();
+
+    // Which bricks a sparse volume stores, indexed (x * by + y) * bz + z for bricksX/Y/Z()
+    // bricks along each axis, and the value every other brick reads as (center if values
+    // is empty). Stored bricks start out at that value too. Dense volumes ignore it.
+    void setBricks(const std::vector<unsigned char> &stored, const std::vector<float> &values);
+
+    inline float operator()(const int x, const int y, const int z) const
+    {
+        if(_storage == STORAGE_SPARSE)
+            return sparseSample(x, y, z);
+        switch(_format)
+        {
+        case FORMAT_FLOAT:
+            return _floats(x, y, z);
+        case FORMAT_UNORM8:
+            return decode(_bytes(x, y, z));
+        default:
+            return decode(_shorts(x, y, z));
+        }
+    };
+    // Writing a value other than its own to a brick a sparse volume does not store
+    // stores it, which must not happen on several threads at once.
+    void set(const int x, const int y, const int z, const float value);
+
+    // Sample z = 0 of a row, with the apron before it and the padding after it, like
+    // VolumeGrid::row.
+    inline const float *row(const int x, const int y) const
+    {
+        return _format == FORMAT_FLOAT && _storage == STORAGE_DENSE ? _floats.row(x, y) : decodeRow(x, y);
+    };
+
+    // Writing a whole row: beginRow returns where to put its floats, from sample
+    // -apron up to the padding, which is the row itself for dense float volumes and
+    // scratch (rowStride() floats) for the others. endRow stores them, apart from the
+    // samples in bricks a sparse volume does not store.
+    inline float *beginRow(const int x, const int y, float *scratch)
+    {
+        return _format == FORMAT_FLOAT && _storage == STORAGE_DENSE ? _floats.row(x, y) : scratch + _apron;
+    };
+    void endRow(const int x, const int y, const float *row);
+
+    Format format() const { return _format; };
+    Storage storage() const { return _storage; };
+    float center() const { return _center; };
+    float width() const { return _width; };
+
+    unsigned apron() const { return _apron; };
+    size_t rowStride() const { return _rowStride; };
+    size_t bytes() const;
+    bool empty() const { return _floats.empty() && _shorts.empty() && _bytes.empty() && _slots.empty(); };
+
+    unsigned bricksX() const { return _bricksX; };
+    unsigned bricksY() const { return _bricksY; };
+    unsigned bricksZ() const { return _bricksZ; };
+    size_t storedBricks() const { return _storedBricks; };
+
+private:
+
+    uint16_t encode(const float value) const;
+    float decode(const uint16_t code) const { return _center + _width * _table[code]; };
+    const float *decodeRow(const int x, const int y) const;
+    size_t storeBrick(const size_t brick);
+
+    inline float sparseSample(const int x, const int y, const int z) const
+    {
+        const unsigned i = x + _apron, j = y + _apron, k = z + _apron;
+        const size_t brick = ((size_t)(i / BRICK) * _bricksY + j / BRICK) * _bricksZ + k / BRICK;
+        const int32_t slot = _slots[brick];
+        if(slot < 0)
+            return _constants[brick];
+        const size_t offset = (size_t)slot * BRICK_SAMPLES + ((i % BRICK) * BRICK + j % BRICK) * BRICK + k % BRICK;
+        switch(_format)
+        {
+        case FORMAT_FLOAT:
+            return _floatBricks[offset];
+        case FORMAT_UNORM8:
+            return decode(_byteBricks[offset]);
+        default:
+            return decode(_shortBricks[offset]);
+        }
+    };
+
+    Format _format;
+    Storage _storage;
+    float _center, _width;
+    unsigned _apron;
+    size_t _rowStride;
+
+    // value = center + width * table[code] for the formats stored as codes. Half
+    // floats have center 0 and width 1.
+    const float *_table;
+
+    VolumeGrid<float> _floats;
+    VolumeGrid<uint16_t> _shorts;
+    VolumeGrid<uint8_t> _bytes;
+
+    // Sparse volumes: the slot in the brick arrays of every brick, or -1 if it is not
+    // stored, and the value of the bricks that are not.
+    unsigned _bricksX, _bricksY, _bricksZ;
+    size_t _storedBricks;
+    std::vector<int32_t> _slots;
+    std::vector<float> _constants;
+    std::vector<float> _floatBricks;
+    std::vector<uint16_t> _shortBricks;
+    std::vector<uint8_t> _byteBricks;
+};
@@ -41,6 +41,9 @@ public:
 
 	~ShaderProgram();
 
+	/// The projection of the scene, also used to tell how large things appear on screen
+	static glm::mat4 projection(float width, float height);
+
 	void updateCommonUniforms(MouseRotator rotator, float width, float height, float time, glm::vec3 clear_color, glm::vec3 light_direction);
 
 protected:
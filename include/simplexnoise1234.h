@@ -29,3 +29,7 @@
     float snoise2( float x, float y );
     float snoise3( float x, float y, float z );
     float snoise4( float x, float y, float z, float w );
+
+/** 3D simplex noise that also returns its gradient in (*dx, *dy, *dz)
+ */
+    float sdnoise3( float x, float y, float z, float *dx, float *dy, float *dz );
@@ -0,0 +1,135 @@
+#pragma once
+
+#include <vector>
+#include <map>
+#include <cstddef>
+
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+
+#include "glm/glm.hpp"
+
+#include "vertexformat.h"
+
+// Hands out ranges of a buffer, first fit. Free ranges are kept sorted by offset
+// and merged with their neighbours when released, so replaced cells leave no holes
+// that a cell of the same size cannot reuse.
+class RangeAllocator
+{
+public:
+
+    RangeAllocator(const unsigned capacity = 0);
+
+    // Find a free range of size elements, returns false if there is none.
+    bool allocate(const unsigned size, unsigned &offset);
+    void release(const unsigned offset, const unsigned size);
+
+    // Add the elements from the current capacity up to the new one as free space.
+    void grow(const unsigned capacity);
+
+    unsigned capacity() const { return _capacity; };
+    unsigned used() const { return _used; };
+
+private:
+
+    // Offset -> size of each free range.
+    std::map<unsigned, unsigned> _free;
+    unsigned _capacity;
+    unsigned _used;
+};
+
+// One vertex and one index buffer shared by all terrain cells. Every cell gets a
+// range of each, and all visible cells are drawn with a single
+// glMultiDrawElementsIndirect, one command per cell.
+//
+// The vertices are stored in one of the VertexFormat layouts. With a packed layout
+// each command's base instance is its cell's id, which picks the cell's origin and
+// quantum from a per-instance attribute, and the arena sets the current program's
+// packedVertices uniform while it draws so the shader decodes them.
+class TerrainArena
+{
+public:
+
+    // Counters since the last resetFrameStats().
+    struct FrameStats
+    {
+        unsigned drawCalls;
+        unsigned cellsDrawn;
+        unsigned trianglesDrawn;
+        size_t bytesUploaded;
+    };
+
+    // Capacities in vertices and triangles, the arena grows when they are exceeded.
+    // Packed cells share the quantum, a power of two from VertexFormat::quantum, so
+    // their borders meet. With 0 every cell picks its own from its bounding box.
+    TerrainArena(const unsigned vertexCapacity, const unsigned triangleCapacity,
+        const VertexFormat::Layout layout = VertexFormat::LAYOUT_FLOAT, const float quantum = 0.0f);
+    ~TerrainArena();
+
+    // Copy a mesh (interleaved positions and normals, triangles indexing it from 0)
+    // into the arena and return the id of its cell. Ids of removed cells are reused.
+    unsigned addCell(const std::vector<glm::vec3> &vertexData, const std::vector<glm::ivec3> &indices);
+    // The same from arrays anywhere in memory, like a mapped file.
+    unsigned addCell(const glm::vec3 *vertexData, const size_t vertexDataSize, const glm::ivec3 *indices, const size_t numberOfIndices);
+    void removeCell(const unsigned cell);
+    void setVisible(const unsigned cell, const bool visible);
+
+    void draw();
+
+    const FrameStats &frameStats() const { return _stats; };
+    void resetFrameStats();
+
+    // Memory of the vertex and index buffers, and how much of it cells use.
+    size_t capacityBytes() const;
+    size_t usedBytes() const;
+
+    // Memory a cell takes once uploaded, with the arguments of addCell.
+    size_t cellBytes(const size_t vertexDataSize, const size_t numberOfIndices) const;
+
+    VertexFormat::Layout layout() const { return _layout; };
+
+private:
+
+    // The vertex range holds numberOfVertices positions and normals, the index range
+    // numberOfIndices indices relative to the first vertex.
+    struct Cell
+    {
+        unsigned firstVertex, numberOfVertices;
+        unsigned firstIndex, numberOfIndices;
+        bool used, visible;
+    };
+
+    // Layout GL reads from the indirect buffer.
+    struct DrawCommand
+    {
+        GLuint count;
+        GLuint instanceCount;
+        GLuint firstIndex;
+        GLint baseVertex;
+        GLuint baseInstance;
+    };
+
+    TerrainArena(const TerrainArena &) = delete;
+    TerrainArena &operator=(const TerrainArena &) = delete;
+
+    void resize(const unsigned vertexCapacity, const unsigned indexCapacity);
+
+    std::vector<Cell> _cells;
+    std::vector<unsigned> _freeCells;
+    RangeAllocator _vertexRanges;
+    RangeAllocator _indexRanges;
+
+    std::vector<DrawCommand> _commands;
+    FrameStats _stats;
+
+    const VertexFormat::Layout _layout;
+    const size_t _vertexBytes;
+    const float _quantum;
+    std::vector<unsigned char> _packed;
+
+    // Origin and quantum of every cell's packed positions, indexed by cell id.
+    std::vector<glm::vec4> _origins;
+    bool _originsChanged;
+
+    GLuint _VAO, _VBO, _EBO, _indirectBuffer, _originBuffer;
+};
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include <cstddef>
+
+// Keeps the most recent samples of a timing (frame times, load latencies, ...)
+// and reports percentiles over them.
+class TimingStats
+{
+public:
+
+    TimingStats(const size_t capacity = 1024) : _capacity(capacity), _next(0) {};
+
+    void add(const double sample)
+    {
+        if(_samples.size() < _capacity)
+            _samples.push_back(sample);
+        else
+            _samples[_next] = sample;
+        _next = (_next + 1) % _capacity;
+    };
+
+    // The p:th percentile (0 to 100) of the kept samples, 0 if there are none.
+    double percentile(const double p) const
+    {
+        if(_samples.empty())
+            return 0.0;
+        std::vector<double> sorted(_samples);
+        const size_t k = std::min(sorted.size() - 1, (size_t)(p / 100.0 * (sorted.size() - 1) + 0.5));
+        std::nth_element(sorted.begin(), sorted.begin() + k, sorted.end());
+        return sorted[k];
+    };
+
+    size_t count() const { return _samples.size(); };
+    void clear() { _samples.clear(); _next = 0; };
+
+private:
+
+    size_t _capacity;
+    size_t _next;
+    std::vector<double> _samples;
+};
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+#include <stdint.h>
+
+#include <glm/glm.hpp>
+
+// Vertex layouts the terrain can be drawn with, and the packing from the interleaved
+// positions and normals the mesher makes.
+//
+// The packed layouts store positions as 16-bit steps of a power of two quantum from
+// an origin on the same lattice, so the shader gets them back with one multiply and
+// add that are exact in single precision. Neighbouring cells packed with the same
+// quantum decode their shared border vertices to identical positions, which keeps
+// the seams closed. Normals are stored as octahedral coordinates: the unit sphere
+// folded onto the square [-1, 1]^2, rounded to whichever neighbouring code is
+// closest in angle.
+class VertexFormat
+{
+public:
+
+    enum Layout
+    {
+        // Position and normal as two vec3, 24 bytes.
+        LAYOUT_FLOAT,
+        // 16-bit positions and a 2 x 16-bit octahedral normal, 12 bytes.
+        LAYOUT_PACKED,
+        // 16-bit positions and a 2 x 8-bit octahedral normal, 8 bytes.
+        LAYOUT_COMPACT
+    };
+    static const unsigned NUMBER_OF_LAYOUTS = 3;
+
+    // The GL reads the positions as unsigned shorts and the normals as normalized
+    // signed values, the fourth position component of PackedVertex is padding.
+    struct PackedVertex
+    {
+        uint16_t position[4];
+        int16_t normal[2];
+    };
+    struct CompactVertex
+    {
+        uint16_t position[3];
+        int8_t normal[2];
+    };
+
+    static size_t vertexBytes(const Layout layout);
+    static const char *name(const Layout layout);
+
+    // The smallest power of two that spans extent in fewer than 65535 steps, with
+    // room for rounding the box outwards to the lattice.
+    static float quantum(const float extent);
+
+    // Packs numberOfVertices interleaved positions and normals into out, which is
+    // resized to vertexBytes(layout) * numberOfVertices. Positions are stored as steps
+    // of quantum, doubled as often as needed to fit the mesh in 16 bits. Returns the
+    // origin (xyz) and the quantum used (w), a position decodes as origin + quantum * p.
+    // LAYOUT_FLOAT copies the vertices as they are and returns (0, 0, 0, 1).
+    static glm::vec4 pack(const Layout layout, const glm::vec3 *vertexData, const size_t numberOfVertices, const float quantum,
+        std::vector<unsigned char> &out);
+
+    // Decodes packed vertices back to interleaved positions and normals, the way the
+    // vertex shader does.
+    static void unpack(const Layout layout, const unsigned char *packed, const size_t numberOfVertices, const glm::vec4 &origin,
+        std::vector<glm::vec3> &vertexData);
+
+    // Octahedral coordinates of a unit vector and back.
+    static glm::vec2 encodeOctahedral(const glm::vec3 &normal);
+    static glm::vec3 decodeOctahedral(const glm::vec2 &coordinates);
+};
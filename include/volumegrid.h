@@ -0,0 +1,85 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+
+// A contiguous 3D volume of samples, stored row-major with x as the slowest
+// and z as the fastest varying axis (the same order as data[x][y][z]).
+// Every z-row is padded to a multiple of ROW_ALIGNMENT elements (one vector
+// width of floats) so a row can be walked in whole vectors. Neither the storage
+// nor the first sample past the apron is aligned, so use unaligned loads.
+// An optional apron of extra samples can be kept around the volume, these
+// are addressed with negative indices or indices past the last sample.
+template <typename T>
+class VolumeGrid
+{
+public:
+
+    static const unsigned ROW_ALIGNMENT = 8;
+
+    VolumeGrid() : _nx(0), _ny(0), _nz(0), _apron(0), _rowStride(0), _planeStride(0) {};
+
+    VolumeGrid(const unsigned nx, const unsigned ny, const unsigned nz, const unsigned apron = 0, const T value = T())
+    {
+        resize(nx, ny, nz, apron, value);
+    };
+
+    void resize(const unsigned nx, const unsigned ny, const unsigned nz, const unsigned apron = 0, const T value = T())
+    {
+        _nx = nx;
+        _ny = ny;
+        _nz = nz;
+        _apron = apron;
+
+        // Pad each row to a whole number of vectors.
+        _rowStride = ((nz + 2 * apron + ROW_ALIGNMENT - 1) / ROW_ALIGNMENT) * ROW_ALIGNMENT;
+        _planeStride = _rowStride * (ny + 2 * apron);
+
+        _samples.assign(_planeStride * (nx + 2 * apron), value);
+    };
+
+    // Free the memory held by the volume.
+    void release()
+    {
+        std::vector<T>().swap(_samples);
+        _nx = _ny = _nz = 0;
+        _rowStride = _planeStride = 0;
+    };
+
+    // Offset of a sample from the start of the storage.
+    inline size_t index(const int x, const int y, const int z) const
+    {
+        return (size_t)(x + (int)_apron) * _planeStride + (size_t)(y + (int)_apron) * _rowStride + (size_t)(z + (int)_apron);
+    };
+
+    inline T &operator()(const int x, const int y, const int z) { return _samples[index(x, y, z)]; };
+    inline const T &operator()(const int x, const int y, const int z) const { return _samples[index(x, y, z)]; };
+
+    // Pointers to sample z = 0 of a row and to sample (y, z) = (0, 0) of a plane.
+    // Neighbouring rows are rowStride() elements apart, planes planeStride().
+    inline T *row(const int x, const int y) { return &_samples[index(x, y, 0)]; };
+    inline const T *row(const int x, const int y) const { return &_samples[index(x, y, 0)]; };
+    inline T *plane(const int x) { return &_samples[index(x, 0, 0)]; };
+    inline const T *plane(const int x) const { return &_samples[index(x, 0, 0)]; };
+
+    unsigned sizeX() const { return _nx; };
+    unsigned sizeY() const { return _ny; };
+    unsigned sizeZ() const { return _nz; };
+    unsigned apron() const { return _apron; };
+    size_t rowStride() const { return _rowStride; };
+    size_t planeStride() const { return _planeStride; };
+
+    bool empty() const { return _samples.empty(); };
+    size_t bytes() const { return _samples.size() * sizeof(T); };
+    T *data() { return _samples.data(); };
+    const T *data() const { return _samples.data(); };
+
+private:
+
+    unsigned _nx, _ny, _nz;
+    unsigned _apron;
+    size_t _rowStride;
+    size_t _planeStride;
+
+    std::vector<T> _samples;
+};
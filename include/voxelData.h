@@ -6,49 +6,275 @@
 #include <map>
 #include <omp.h>
 
-#define GLEW_STATIC
-#include <GL/glew.h>
-#include <GLFW/glfw3.h>
-
 #include "glm/glm.hpp"
 #include "lookuptable.h"
+#include "classify.h"
 #include "simplexnoise1234.h"
+#include "simplexnoisebatch.h"
+#include "samplevolume.h"
+#include "brickpyramid.h"
 
 class VoxelData
 {
 public:
+
+    // How generateTriangles builds the mesh. Unindexed gives every triangle three
+    // vertices of its own, indexed creates one vertex per intersected grid edge
+    // and lets all triangles around it share that vertex.
+    enum MeshMode { MESH_UNINDEXED, MESH_INDEXED };
+
+    // How the mesh is assembled. Blocks meshes groups of slabs into arrays of their
+    // own and merges them, two-pass counts the triangles and vertices first and then
+    // writes straight into the exactly sized interleaved vertex array.
+    enum MeshStrategy { MESH_BLOCKS, MESH_TWO_PASS };
+
+    // How vertex normals are estimated. Sobel sums a 3x3x3 neighbourhood around both
+    // ends of the edge (unnormalized). Central precomputes central differences at the
+    // grid points next to the surface and interpolates them along the edge. Analytic
+    // evaluates the exact gradient of the noise field at the vertex. Both of the
+    // latter are normalized.
+    enum NormalMode { NORMALS_SOBEL, NORMALS_CENTRAL, NORMALS_ANALYTIC };
+
+    // How generateData fills the volume. Full evaluates every octave at every sample.
+    // Bounded is given the isovalue the volume will be meshed at, and fills bricks of
+    // samples that stay on one side of it (apron included) with a constant instead,
+    // which leaves that mesh unchanged. It decides by proven bounds on the noise and
+    // how fast it changes. Truncated also stops adding octaves to samples once the
+    // remaining ones cannot bring them across the isovalue, which moves vertices by a
+    // little. Meshing at another isovalue needs a full volume.
+    enum GenerationMode { GENERATE_FULL, GENERATE_BOUNDED, GENERATE_TRUNCATED };
     
     VoxelData(const unsigned dim, const float gridSize, const glm::vec3 gridCenter = glm::vec3(0));
+
+    // A cell of the seamless layout, centered at gridSize * cell. All such cells of one
+    // dim and size sample a single lattice, so sample dim of a cell is sample 0 of the
+    // next one and their meshes meet without cracks. They keep an apron of one sample
+    // around the volume, which lets normals on a border see past it like the neighbour does.
+    VoxelData(const unsigned dim, const float gridSize, const glm::ivec3 &cell);
+
+    // The sides of a seamless cell that have neighbours in the ground plane.
+    enum Face { FACE_LOW_X, FACE_HIGH_X, FACE_LOW_Z, FACE_HIGH_Z };
+    static Face oppositeFace(const Face face) { return (Face)(face ^ 1); };
     
+    void setGenerationMode(const GenerationMode mode, const float isovalue = 0.5) { _generationMode = mode; _generationIsovalue = isovalue; };
+
+    // How the samples are stored, see SampleVolume. The unorm formats are finest around
+    // the isovalue the volume will be meshed at, and all cells that share samples or
+    // borders must use the same format and isovalue. Sparse storage keeps only the
+    // bricks bounded or truncated generation evaluates the noise in, which does not
+    // change the mesh; with full generation it stores every brick. Discards the samples,
+    // so it is set before generateData.
+    void setSampleFormat(const SampleVolume::Format format, const float isovalue = 0.5,
+        const SampleVolume::Storage storage = SampleVolume::STORAGE_DENSE);
+    SampleVolume::Format getSampleFormat() const { return _data.format(); };
+    SampleVolume::Storage getSampleStorage() const { return _data.storage(); };
+    const SampleVolume &getSamples() const { return _data; };
     void generateData(const float noiseScale = 0.1);
 
+    // Share of the noise work of a full volume (samples times octaves) the last generateData did.
+    double getNoiseWork() const { return _noiseWork; };
+
+    // The samples a seamless cell shares with the neighbour across a face: the face and
+    // the planes on both sides of it, apron included. A slab taken from a generated
+    // neighbour's opposite face can be handed to the next generateData, which copies it
+    // instead of evaluating the noise there. The neighbour must have the same dim, size,
+    // noise scale, generation mode and sample format. Both return false for cells that are not
+    // seamless, or a slab that does not fit. Cells bent to a coarser neighbour or not
+    // generated have no slab to give.
+    bool getBorderSlab(const Face face, std::vector<float> &slab) const;
+    bool setBorderSlab(const Face face, const std::vector<float> &slab);
+
+    // The dim of the seamless neighbour across a face, set before generateData. A neighbour
+    // with a power of two fewer samples per side makes generateTriangles bend this cell's
+    // face to the neighbour's coarser samples and snap the face's vertices to the
+    // neighbour's, so the two meshes share every vertex and edge on the face. The coarser
+    // cell needs nothing. Returns false for a coarser dim that does not divide this one
+    // by a power of two.
+    bool setNeighbourDimension(const Face face, const unsigned dim);
+
+    // The dim of the neighbour across the vertical edge where an x-face and a z-face
+    // meet. The four cells around such an edge all bend it to the coarsest of them, so
+    // a cell also needs the one across the corner, which the faces do not show when it
+    // is coarser than both cells beside it. Returns false like setNeighbourDimension, or
+    // for faces that do not meet.
+    bool setCornerDimension(const Face xFace, const Face zFace, const unsigned dim);
+
+    void setMeshMode(const MeshMode mode) { _meshMode = mode; };
+    void setMeshStrategy(const MeshStrategy strategy) { _meshStrategy = strategy; };
+    void setNormalMode(const NormalMode mode) { _normalMode = mode; };
     void generateTriangles(const float isovalue = 0.5);
 
     void getInfo(bool showdata = false, bool printvertices = false, bool printnormals = false) const;
-    int getNumberOfTriangles() const { return _indices.size(); };
+    int getNumberOfTriangles() const { return _numberOfTriangles; };
+    int getNumberOfVertices() const { return _numberOfVertices; };
+
+    // Cubes the surface passed through in the last generateTriangles.
+    unsigned getNumberOfActiveCubes() const { return _numberOfActiveCubes; };
+
+    // Bricks of BrickPyramid::BRICK^3 cubes in the volume, and how many of them the
+    // last generateTriangles skipped since the surface does not pass through them.
+    unsigned getNumberOfBricks() const { return _activeBricks.size(); };
+    unsigned getNumberOfSkippedBricks() const { return _activeBricks.size() - _numberOfActiveBricks; };
+
+    // Interleaved vertex positions and normals, and the triangles indexing them.
+    const std::vector<glm::vec3> &getVertexData() const { return _VBOarray; };
+    const std::vector<glm::ivec3> &getIndices() const { return _indices; };
+
+    // Free the CPU copies of the mesh once it has been used. The triangle and
+    // vertex counts keep working, getVertexData returns an empty array.
+    void releaseMeshData();
+
+    // Most memory held at once while meshing, including the volume.
+    size_t getPeakMeshingBytes() const { return _peakMeshingBytes; };
+
+    // Seconds the last generateTriangles spent in each phase. Gradients is the central
+    // difference precompute, packing the interleaving of the block strategy's arrays.
+    struct MeshTimings { double gradients, mesh, packing; };
+    const MeshTimings &getMeshTimings() const { return _meshTimings; };
+
+    unsigned getDimension() const { return _dim; };
+    float getGridSize() const { return _gridSize; };
+    const glm::vec3 &getGridCenter() const { return _gridCenter; };
+
+    // Everything else the mesh depends on, besides the noise scale and the isovalue.
+    bool isSeamless() const { return _seamless; };
+    GenerationMode getGenerationMode() const { return _generationMode; };
+    MeshMode getMeshMode() const { return _meshMode; };
+    MeshStrategy getMeshStrategy() const { return _meshStrategy; };
+    NormalMode getNormalMode() const { return _normalMode; };
+    unsigned getNeighbourDimension(const Face face) const { return _coarseRatio[face] > 1 ? _dim / _coarseRatio[face] : 0; };
+    unsigned getCornerDimension(const Face xFace, const Face zFace) const
+    {
+        const unsigned ratio = _cornerRatio[xFace & 1][zFace & 1];
+        return ratio > 1 ? _dim / ratio : 0;
+    };
+
+    // Bumped whenever the same parameters give other volumes or meshes, so results
+    // kept from an older version are not mistaken for current ones.
+    static const unsigned GENERATOR_VERSION = 3;
 
-    void draw() const;
-    void drawBoundingBox() const;
+    // The octaves of the terrain noise at noiseScale: eight, each with twice the
+    // frequency and half the amplitude of the last. Every path that evaluates the
+    // field takes them from here.
+    static FbmOctaves terrainOctaves(const float noiseScale);
+
+    // Whether generateData has filled the volume. Cells whose mesh came from elsewhere
+    // have no samples to re-mesh or share.
+    bool hasData() const { return _hasData; };
 
 private:
 
-    void createTriangle(unsigned e1, unsigned e2, unsigned e3, const unsigned x, const unsigned y, const unsigned z);
+    // Number of x-slabs meshed together as one unit of parallel work.
+    static const unsigned SLABS_PER_BLOCK = 4;
+
+    // The part of the mesh created from one block of slabs, with vertex ids local to
+    // the block. Negative ids refer to vertices owned by the next block.
+    struct MeshBlock
+    {
+        std::vector<glm::vec3> vertices;
+        std::vector<glm::vec3> normals;
+        std::vector<glm::ivec3> indices;
+        std::vector<int> firstPlane;
+        unsigned activeCubes = 0;
+    };
+
+    // Vertex ids of the grid edges touched by one slab of cubes, -1 if the edge has
+    // no vertex yet. The planes hold the y- and z-edges at the slab's lower and upper
+    // x, slabEdges the x-edges between them, all indexed by (y, z).
+    struct EdgeCache
+    {
+        std::vector<int> lowPlane, highPlane, slabEdges;
+
+        void resize(const unsigned n)
+        {
+            lowPlane.resize(2 * n * n);
+            highPlane.resize(2 * n * n);
+            slabEdges.resize(n * n);
+        }
+    };
+
+    void boundBricks(const unsigned bricks, std::vector<unsigned char> &noise, std::vector<float> &value) const;
+    unsigned addNoise(const float x, const float y, const float *z, float *out, const unsigned count) const;
+    glm::ivec3 borderSample(const Face face, const int p, const int u, const int v) const;
+    void copyBorderSlab(const Face face);
+
+    bool conforming() const;
+    unsigned edgeRatio(const Face face, const int w) const;
+    void conformBorders();
+    glm::vec3 coarseCrossing(const glm::ivec3 &pos, const int axis, const int spacing) const;
+    void conformVertex(const glm::ivec3 &pos1, const glm::ivec3 &pos2, glm::vec3 &gridPos) const;
+    void dropCollapsedTriangles();
+
+    unsigned classifyRow(const unsigned x, const unsigned y, unsigned char *cases, unsigned *active) const;
+
+    void generateTrianglesInBlocks();
+    void generateBlockUnindexed(const unsigned block, MeshBlock &out);
+    void generateBlockIndexed(const unsigned block, MeshBlock &out, EdgeCache &cache);
+    void mergeBlocks(std::vector<MeshBlock> &blocks);
+
+    void generateTrianglesTwoPass();
+    void activeSpans(const unsigned x, const unsigned y, std::vector<unsigned> &spans) const;
+    unsigned numberLayer(const unsigned x, const unsigned firstId, int *planeIds, int *xEdgeIds, const bool writeVertices);
+
+    void createTriangle(unsigned e1, unsigned e2, unsigned e3, const unsigned x, const unsigned y, const unsigned z, MeshBlock &out);
+    void createVertex(const glm::ivec3 &pos1, const glm::ivec3 &pos2, glm::vec3 &vertex, glm::vec3 &normal) const;
+    void computeGradients();
+    const glm::vec3 gradientAt(const glm::ivec3 &pos) const;
+    const glm::vec3 analyticNormal(const glm::vec3 &gridPos) const;
+    void getEdgePositions(const unsigned edge, const unsigned x, const unsigned y, const unsigned z, glm::ivec3 &pos1, glm::ivec3 &pos2) const;
+
+    size_t meshingBytes() const;
+    void notePeakMeshingBytes(const size_t bytes) { _peakMeshingBytes = std::max(_peakMeshingBytes, bytes); };
 
     const glm::ivec3 getPosition(const unsigned v, unsigned x, unsigned y, unsigned z) const;
-    const glm::vec3 getWorldPosition(const unsigned x, const unsigned y, const unsigned z) const;
+    float planeValue(const int y) const;
+    const glm::vec3 getWorldPosition(const int x, const int y, const int z) const;
+    const glm::vec3 getWorldPosition(const glm::vec3 &gridPos) const;
     
     void createVBO();
-    void createBuffers();
 
     // Data structures for the voxels.
     const unsigned _dim;
     const float _gridSize;
     const glm::vec3 _gridCenter;
+    const bool _seamless;
+    const glm::ivec3 _cell;
     float _isovalue;
-    std::vector<std::vector<std::vector<float>>> _data;
+    SampleVolume _data;
+
+    // Value ranges of the bricks of _data, built with it, and the bricks that straddle
+    // the current isovalue. Only the cubes of those are classified.
+    BrickPyramid _bricks;
+    std::vector<unsigned char> _activeBricks;
+    unsigned _numberOfActiveBricks = 0;
+    FbmOctaves _fbm;
+
+    GenerationMode _generationMode = GENERATE_FULL;
+    float _generationIsovalue = 0.5f;
+    double _noiseWork = 0.0;
+    bool _hasData = false;
+
+    // Planes shared with each neighbour, handed over for the next generateData.
+    static const unsigned BORDER_PLANES = 3;
+    std::vector<float> _borderSlabs[4];
+
+    // How many of this cell's samples per side the neighbour across each face has per
+    // sample, 1 unless it is coarser.
+    unsigned _coarseRatio[4] = {1, 1, 1, 1};
 
-    unsigned _idCounter = 0;
-    unsigned getVertexId(const glm::vec3 v1, const glm::vec3 v2);
+    // The same for the neighbours across the vertical edges, by the low or high x and z side.
+    unsigned _cornerRatio[2][2] = {{1, 1}, {1, 1}};
+
+    MeshMode _meshMode = MESH_INDEXED;
+    MeshStrategy _meshStrategy = MESH_TWO_PASS;
+    NormalMode _normalMode = NORMALS_SOBEL;
+
+    // Central difference gradients for NORMALS_CENTRAL, only kept while meshing. Rows of
+    // grid points map to a slot of three padded rows (x, y and z components) or -1.
+    std::vector<int> _gradientRows;
+    std::vector<float> _gradients;
+    size_t _peakMeshingBytes = 0;
+    MeshTimings _meshTimings = MeshTimings();
 
     // Create a lookup-table for the triangle generation.
     LookupTable _table;
@@ -59,21 +285,13 @@ private:
     std::vector<glm::ivec3> _indices;
 
     std::vector<glm::vec3> _VBOarray;
-    GLuint VBO, VAO, EBO;
-
-    // Data structures for the bounding box.
-    std::vector<glm::vec3> _boundingBoxVertices;
-    std::vector<unsigned> _boundingBoxIndices;
-    GLuint VBO_b, VAO_b, EBO_b;
-    
-
-    // Lock for writing vertex/normal and indices in parallel
-    omp_lock_t writelock;
-    omp_lock_t writelockIndices;
+    unsigned _numberOfTriangles = 0;
+    unsigned _numberOfVertices = 0;
+    unsigned _numberOfActiveCubes = 0;
 
 
 
-    inline int clamp(int n, int lower, int upper) {
+    static inline int clamp(int n, int lower, int upper) {
         return std::max(lower, std::min(n, upper));
     }
     
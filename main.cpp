@@ -4,6 +4,7 @@
 #include <GLFW/glfw3.h>
 #include <math.h>
 #include <algorithm>
+#include <memory>
 
 // Raytracer
 #include "window.h"
@@ -12,18 +13,46 @@
 #include "quad.h"
 #include "sphere.h"
 #include "voxelData.h"
+#include "boundingbox.h"
+#include "terrainarena.h"
+#include "chunkmanager.h"
+#include "timingstats.h"
+#include "jobpool.h"
+#include "profiler.h"
+#include "lodscheduler.h"
+#include "cellcache.h"
+#include "vertexformat.h"
 //#include "skybox.h"
 
 #define W 1000
 #define H 1000
 
-// Run with ./main gridDimension gridSize noiseScale isoValue
+// Run with ./main gridDimension gridSize noiseScale cellGrid levelsOfDetail indexedMesh normalMode streamRadius
+//               triangleBudget targetFrameMs vertexLayout sampleFormat sparseSamples
+// levelsOfDetail: 0 = every cell at full detail, 1 = the default of up to 4 levels, more = up
+// to that many. Each level has half the samples per side of the one before, so there are
+// only as many as halve gridDimension evenly and keep 4 samples (3 for the default 100, 4
+// for 128); the count used is printed. Cells take the coarsest level that looks right from
+// the camera, re-meshed as it moves. A triangleBudget and
+// targetFrameMs (0 for none) make them coarser still.
+// normalMode: 0 = Sobel estimate, 1 = central differences, 2 = analytic noise gradient
+// streamRadius: if > 0, cells are streamed in within this many cells of the camera
+// instead of building a fixed cellGrid. Fly with WASD (shift for speed).
+// vertexLayout: 0 = float positions and normals (24 bytes), 1 = packed (12 bytes),
+// 2 = compact (8 bytes), see VertexFormat.
+// sampleFormat: 0 = float samples (4 bytes), 1 = half, 2 = unorm16 (2 bytes), 3 = unorm8
+// (1 byte), see SampleVolume. The unorm ones are finest around the starting isovalue.
+// sparseSamples: 1 keeps only the bricks of samples near the surface, which lets a cell
+// have many more samples per side. Only streamed cells save memory, the fixed cells keep
+// every brick so they can be re-meshed at other isovalues.
+// +/- raises and lowers the isovalue of the fixed cells, which are then re-meshed.
 
 bool WIREFRAME = false;
 bool BOUNDINGBOXES = false;
 int FOG = 0;
 int CRAZY = 0;
 float STARTTIME = 0;
+float ISOSTEP = 0;
 
 void key_callback(GLFWwindow* window, int key, int scancode, int action, int mode)
 {
@@ -52,6 +81,11 @@ void key_callback(GLFWwindow* window, int key, int scancode, int action, int mod
 		CRAZY = 1;
 		STARTTIME = glfwGetTime();
 	}
+
+	if ((key == GLFW_KEY_EQUAL || key == GLFW_KEY_KP_ADD) && action != GLFW_RELEASE)
+		ISOSTEP += 0.01f;
+	else if ((key == GLFW_KEY_MINUS || key == GLFW_KEY_KP_SUBTRACT) && action != GLFW_RELEASE)
+		ISOSTEP -= 0.01f;
 }
 
 int main(int argc, const char * argv[])
@@ -59,7 +93,7 @@ int main(int argc, const char * argv[])
 	// Variables for the fps-counter
 	double t0 = 0.0;
 	int frames = 0;
-	char titlestring[200];
+	char titlestring[400];
 
 	// Define window
 	GLFWwindow *window = nullptr;
@@ -93,7 +127,15 @@ int main(int argc, const char * argv[])
 	float noiseScale = 0.1;
 	float isoValue = 0.55;
 	int cellGrid = 1; 
-	bool useLODs = false;
+	int levelsOfDetail = 0;
+	bool indexedMesh = true;
+	int normalMode = VoxelData::NORMALS_SOBEL;
+	float streamRadius = 0;
+	int triangleBudget = 0;
+	float targetFrameMs = 0;
+	int vertexLayout = VertexFormat::LAYOUT_FLOAT;
+	int sampleFormat = SampleVolume::FORMAT_FLOAT;
+	bool sparseSamples = false;
 
 	if(argc > 1 && atof(argv[1]) > 0)
 		gridDimension = atof(argv[1]);
@@ -103,46 +145,235 @@ int main(int argc, const char * argv[])
 		noiseScale = atof(argv[3]);
 	if(argc > 4 && atof(argv[4]))
 		cellGrid = atof(argv[4]);
-	if(argc > 5 && atof(argv[5]))
-		useLODs = atof(argv[5]);
+	if(argc > 5 && atoi(argv[5]) > 0)
+		levelsOfDetail = atoi(argv[5]) == 1 ? 4 : atoi(argv[5]);
+	if(argc > 6)
+		indexedMesh = atof(argv[6]);
+	if(argc > 7 && atoi(argv[7]) >= 0 && atoi(argv[7]) <= VoxelData::NORMALS_ANALYTIC)
+		normalMode = atoi(argv[7]);
+	if(argc > 8 && atof(argv[8]) > 0)
+		streamRadius = atof(argv[8]);
+	if(argc > 9 && atoi(argv[9]) > 0)
+		triangleBudget = atoi(argv[9]);
+	if(argc > 10 && atof(argv[10]) > 0)
+		targetFrameMs = atof(argv[10]);
+	if(argc > 11 && atoi(argv[11]) >= 0 && atoi(argv[11]) < (int)VertexFormat::NUMBER_OF_LAYOUTS)
+		vertexLayout = atoi(argv[11]);
+	if(argc > 12 && atoi(argv[12]) >= 0 && atoi(argv[12]) < (int)SampleVolume::NUMBER_OF_FORMATS)
+		sampleFormat = atoi(argv[12]);
+	if(argc > 13)
+		sparseSamples = atoi(argv[13]);
+
+	// Set TERRAIN_TRACE to a file name to record a Chrome trace of the run.
+	const char *tracePath = getenv("TERRAIN_TRACE");
+	Profiler::setEnabled(tracePath != NULL);
+	Profiler::setThreadName("main");
+
+	// Set TERRAIN_CACHE to a directory to keep the cells' meshes between runs, at most
+	// TERRAIN_CACHE_MB megabytes of them (1024 by default).
+	std::unique_ptr<CellCache> cache;
+	if(getenv("TERRAIN_CACHE"))
+	{
+		const size_t megabytes = getenv("TERRAIN_CACHE_MB") ? atoi(getenv("TERRAIN_CACHE_MB")) : 1024;
+		cache.reset(new CellCache(getenv("TERRAIN_CACHE"), megabytes << 20));
+	}
 
 	float startTime = glfwGetTime();
 
 	// Create data-volumes
-	std::vector<VoxelData> volumes;
-	int triangles = 0;
-	int cellNumber = 0;
-	std::cout << std::endl;
-	for(int i = -cellGrid/2; i <= cellGrid/2; i++)
+	std::vector<std::unique_ptr<VoxelData> > volumes;
+
+	// Buffers shared by all cells, sized from a rough guess of the mesh size and grown if needed.
+	// Packed cells share a quantum fitted to the cell size, so their borders meet.
+	const int numberOfCells = (cellGrid + (1 - cellGrid%2)) * (cellGrid + (1 - cellGrid%2));
+	TerrainArena arena(numberOfCells * 2 * gridDimension * gridDimension, numberOfCells * 3 * gridDimension * gridDimension,
+		(VertexFormat::Layout)vertexLayout, VertexFormat::quantum(gridSize));
+
+	// Workers for generating cells, many at a time.
+	JobPool pool;
+
+	// Position of every cell on the grid.
+	std::vector<glm::ivec2> cellPositions;
+
+	// Picks the detail of every cell from the size of its samples on screen, seen through
+	// the same projection as the scene.
+	LodScheduler::Settings lodSettings;
+	lodSettings.dim = gridDimension;
+	lodSettings.gridSize = gridSize;
+	lodSettings.levels = std::max(levelsOfDetail, 1);
+	lodSettings.focalLength = fabsf(ShaderProgram::projection(W, H)[1][1]) * H / 2.0f;
+	lodSettings.triangleBudget = triangleBudget;
+	lodSettings.targetFrameMs = targetFrameMs;
+	LodScheduler lods(lodSettings, cellGrid);
+	if(levelsOfDetail > 0)
+		std::cout << "Levels of detail: " << lods.levels() << " of the " << levelsOfDetail << " asked for" << std::endl;
+	const bool useLODs = lods.levels() > 1 && streamRadius <= 0;
+	std::vector<unsigned> remesh;
+	if(useLODs)
+		lods.update(rotator.cameraPosition(), 0.0, remesh);
+
+	// A cell at the detail picked for it, with its borders bent to coarser neighbours,
+	// across the faces and the corners, so the meshes meet without cracks.
+	const int side = cellGrid/2 * 2 + 1;
+	auto createCell = [&](const int i, const int j)
+	{
+		const unsigned k = (i + cellGrid/2) * side + j + cellGrid/2;
+		VoxelData *volume = new VoxelData(useLODs ? lods.dimension(k) : gridDimension, gridSize, glm::ivec3(i, 0, j));
+		for(unsigned face = 0; face < 4 && useLODs; face++)
+			if(lods.neighbourDimension(k, face) > 0)
+				volume->setNeighbourDimension((VoxelData::Face)face, lods.neighbourDimension(k, face));
+		for(unsigned xFace = VoxelData::FACE_LOW_X; xFace <= VoxelData::FACE_HIGH_X && useLODs; xFace++)
+			for(unsigned zFace = VoxelData::FACE_LOW_Z; zFace <= VoxelData::FACE_HIGH_Z; zFace++)
+				if(lods.cornerDimension(k, xFace, zFace) > 0)
+					volume->setCornerDimension((VoxelData::Face)xFace, (VoxelData::Face)zFace, lods.cornerDimension(k, xFace, zFace));
+		volume->setMeshMode(indexedMesh ? VoxelData::MESH_INDEXED : VoxelData::MESH_UNINDEXED);
+		volume->setNormalMode((VoxelData::NormalMode)normalMode);
+		volume->setSampleFormat((SampleVolume::Format)sampleFormat, isoValue,
+			sparseSamples ? SampleVolume::STORAGE_SPARSE : SampleVolume::STORAGE_DENSE);
+		return volume;
+	};
+
+	for(int i = -cellGrid/2; i <= cellGrid/2 && streamRadius <= 0; i++)
 	{
 		for(int j = -cellGrid/2; j <= cellGrid/2; j++)
 		{
-			glm::vec3 center = glm::vec3((gridSize) * i, 0.0, (gridSize) * j);
+			volumes.push_back(std::unique_ptr<VoxelData>(createCell(i, j)));
+			cellPositions.push_back(glm::ivec2(i, j));
+		}
+	}
 
-			int levelOfDetail = gridDimension;			
-			//If level of detail should be used.
-			if(useLODs)
-			{
-				levelOfDetail = std::max(6, gridDimension / (std::max(abs(i), abs(j)) + 1));
-				center = center * 0.9f;
-			}
-			else
+	// Generate and mesh the cells on the pool, with one cell per job. This thread
+	// only uploads them, in the order they finish. With fewer cells than workers
+	// each cell is instead generated here with OpenMP using the whole machine.
+	//
+	// Seamless cells are generated in two waves, like the squares of a checkerboard. The
+	// second wave takes the samples it shares with its neighbours from the first.
+	auto secondWave = [&](unsigned k) { return !useLODs && (cellPositions[k].x + cellPositions[k].y) % 2 != 0; };
+	CompletionQueue<unsigned> generatedCells;
+
+	// Maps a cell's mesh kept by an earlier run, or makes it and keeps it for the next.
+	std::vector<std::unique_ptr<MeshFile> > mappedCells(volumes.size());
+	auto buildCell = [&](VoxelData &volume, std::unique_ptr<MeshFile> &mapped, const float isovalue)
+	{
+		if(cache && (mapped = cache->load(CellCache::Key(volume, noiseScale, isovalue))))
+			return;
+		if(!volume.hasData())
+			volume.generateData(noiseScale);
+		volume.generateTriangles(isovalue);
+		if(cache)
+			cache->store(CellCache::Key(volume, noiseScale, isovalue), volume.getVertexData(), volume.getIndices());
+	};
+	auto generateCell = [&](unsigned k)
+	{
+		if(secondWave(k))
+		{
+			const glm::ivec2 neighbours[4] = {glm::ivec2(-1, 0), glm::ivec2(1, 0), glm::ivec2(0, -1), glm::ivec2(0, 1)};
+			std::vector<float> slab;
+			for(unsigned face = 0; face < 4; face++)
 			{
-				center = center * 0.95f;
+				const glm::ivec2 p = cellPositions[k] + neighbours[face] + glm::ivec2(cellGrid/2);
+				if(p.x < 0 || p.y < 0 || p.x >= side || p.y >= side)
+					continue;
+				if(volumes[p.x * side + p.y]->getBorderSlab(VoxelData::oppositeFace((VoxelData::Face)face), slab))
+					volumes[k]->setBorderSlab((VoxelData::Face)face, slab);
 			}
-			volumes.push_back(VoxelData(levelOfDetail, gridSize, center));
-			
-			volumes[volumes.size() - 1].generateData(noiseScale);
-			volumes[volumes.size() - 1].generateTriangles(isoValue);
-			triangles += volumes[volumes.size() - 1].getNumberOfTriangles();
-			cellNumber++;
-			std::cout << "Generating cells " << cellNumber << " of " << pow(cellGrid + (1 - cellGrid%2),2) << std::flush << "\r";
 		}
+		buildCell(*volumes[k], mappedCells[k], isoValue);
+		generatedCells.push(std::move(k));
+	};
+	std::vector<unsigned> order;
+	for(unsigned wave = 0; wave < 2; wave++)
+		for(unsigned k = 0; k < volumes.size(); k++)
+			if(secondWave(k) == (wave == 1))
+				order.push_back(k);
+	unsigned firstWave = 0;
+	while(firstWave < order.size() && !secondWave(order[firstWave]))
+		firstWave++;
+
+	const bool cellsInParallel = volumes.size() >= pool.size();
+	if(cellsInParallel)
+		for(unsigned c = 0; c < firstWave; c++)
+			pool.submit([&generateCell, &order, c] { generateCell(order[c]); });
+
+	std::vector<unsigned> cells(volumes.size());
+
+	// Puts a cell's mesh in the arena, straight from the mapped file if it was cached,
+	// and returns its triangles.
+	auto uploadCell = [&](const unsigned k, std::unique_ptr<MeshFile> &mapped)
+	{
+		if(mapped)
+		{
+			cells[k] = arena.addCell(mapped->vertexData(), mapped->vertexDataSize(), mapped->indices(), mapped->numberOfIndices());
+			const unsigned numberOfTriangles = mapped->numberOfIndices();
+			mapped.reset();
+			return numberOfTriangles;
+		}
+		cells[k] = arena.addCell(volumes[k]->getVertexData(), volumes[k]->getIndices());
+		volumes[k]->releaseMeshData();
+		return (unsigned)volumes[k]->getNumberOfTriangles();
+	};
+	std::vector<BoundingBox> boundingBoxes;
+	int triangles = 0;
+	size_t peakMeshingBytes = 0;
+	std::cout << std::endl;
+	for(unsigned cellNumber = 1; cellNumber <= volumes.size(); cellNumber++)
+	{
+		if(!cellsInParallel)
+			generateCell(order[cellNumber - 1]);
+		// The first wave is done, its neighbours can go.
+		else if(cellNumber == firstWave + 1)
+			for(unsigned c = firstWave; c < order.size(); c++)
+				pool.submit([&generateCell, &order, c] { generateCell(order[c]); });
+
+		unsigned k;
+		generatedCells.waitPop(k);
+		peakMeshingBytes = std::max(peakMeshingBytes, volumes[k]->getPeakMeshingBytes());
+		// The mesh lives in the arena from here on.
+		const unsigned cellTriangles = uploadCell(k, mappedCells[k]);
+		triangles += cellTriangles;
+		boundingBoxes.push_back(BoundingBox(-volumes[k]->getGridCenter(), volumes[k]->getGridSize()));
+		if(useLODs)
+			lods.reportTriangles(k, cellTriangles);
+		std::cout << "Generating cells " << cellNumber << " of " << volumes.size() << std::flush << "\r";
 	}
 
 	float timeElapsed = glfwGetTime() - startTime;
 	std::cout << "\nNumber of triangles generated: " << triangles;
-	std::cout << "\nTime elapsed: " << timeElapsed << " seconds" << std::endl;
+	std::cout << "\nTime elapsed: " << timeElapsed << " seconds";
+	std::cout << "\nPeak meshing memory per cell: " << peakMeshingBytes / (1024.0 * 1024.0) << " MB";
+	std::cout << "\nTerrain buffers: " << arena.usedBytes() / (1024.0 * 1024.0) << " of " << arena.capacityBytes() / (1024.0 * 1024.0) << " MB used" << std::endl;
+	if(cache)
+		std::cout << "Cell cache: " << cache->stats().hits << " hits, " << cache->stats().misses << " misses" << std::endl;
+
+	// Endless terrain, cells are generated in the background as the camera moves.
+	std::unique_ptr<ChunkManager> chunks;
+	if(streamRadius > 0)
+	{
+		ChunkManager::Settings settings;
+		settings.dim = gridDimension;
+		settings.gridSize = gridSize;
+		settings.noiseScale = noiseScale;
+		settings.isovalue = isoValue;
+		settings.meshMode = indexedMesh ? VoxelData::MESH_INDEXED : VoxelData::MESH_UNINDEXED;
+		settings.normalMode = (VoxelData::NormalMode)normalMode;
+		settings.sampleFormat = (SampleVolume::Format)sampleFormat;
+		settings.sampleStorage = sparseSamples ? SampleVolume::STORAGE_SPARSE : SampleVolume::STORAGE_DENSE;
+		settings.viewRadius = streamRadius * gridSize;
+		settings.maxChunks = M_PI * (streamRadius + 1) * (streamRadius + 1) + 8;
+		settings.cache = cache.get();
+		chunks.reset(new ChunkManager(arena, pool, settings));
+		rotator.speed = gridSize;
+	}
+
+	TimingStats frameTimes;
+	double lastFrame = glfwGetTime();
+	double lastFrameMs = 0.0;
+
+	// Cells re-meshed at another detail, built on the pool while the old ones are drawn.
+	std::vector<std::unique_ptr<VoxelData> > remeshed(volumes.size());
+	std::vector<std::unique_ptr<MeshFile> > remeshedMappings(volumes.size());
+	CompletionQueue<unsigned> remeshedCells;
+	unsigned remeshing = 0;
 
 	glm::vec3 clear_color = glm::vec3(1.0f, 1.0f, 1.0f);
 
@@ -150,12 +381,66 @@ int main(int argc, const char * argv[])
 	
 	do
 	{
+		PROFILE_SCOPE("frame");
 		glClearColor(clear_color.x, clear_color.y, clear_color.z, 1.0f);
 		rotator.poll(window);
 		
 		//Checks if any events are triggered (like keyboard or mouse events)
 		glfwPollEvents();
 
+		// Swap in the re-meshed cells as they finish. Once all are in, and no isovalue
+		// change is waiting, the scheduler picks again for where the camera is now.
+		if(useLODs)
+		{
+			unsigned k;
+			while(remeshedCells.tryPop(k))
+			{
+				volumes[k].swap(remeshed[k]);
+				remeshed[k].reset();
+				arena.removeCell(cells[k]);
+				lods.reportTriangles(k, uploadCell(k, remeshedMappings[k]));
+				remeshing--;
+			}
+			if(remeshing == 0 && ISOSTEP == 0 && lods.update(rotator.cameraPosition(), lastFrameMs, remesh))
+				for(unsigned c = 0; c < remesh.size(); c++)
+				{
+					const unsigned k = remesh[c];
+					remeshed[k].reset(createCell(cellPositions[k].x, cellPositions[k].y));
+					remeshing++;
+					pool.submit([&buildCell, &remeshed, &remeshedMappings, &remeshedCells, isoValue, k]
+					{
+						buildCell(*remeshed[k], remeshedMappings[k], isoValue);
+						unsigned cell = k;
+						remeshedCells.push(std::move(cell));
+					});
+				}
+		}
+
+		// Re-mesh the fixed cells at the new isovalue. Their volumes are kept, and the
+		// brick ranges let the mesher skip everything away from the surface. Waits for
+		// cells being re-meshed at another detail.
+		if(ISOSTEP != 0 && !volumes.empty() && remeshing == 0)
+		{
+			isoValue += ISOSTEP;
+			const double remeshStart = glfwGetTime();
+			unsigned skippedBricks = 0, bricks = 0;
+			for(unsigned k = 0; k < volumes.size(); k++)
+			{
+				buildCell(*volumes[k], mappedCells[k], isoValue);
+				if(!mappedCells[k])
+				{
+					skippedBricks += volumes[k]->getNumberOfSkippedBricks();
+					bricks += volumes[k]->getNumberOfBricks();
+				}
+				arena.removeCell(cells[k]);
+				uploadCell(k, mappedCells[k]);
+			}
+			std::cout << "Isovalue " << isoValue << " re-meshed in " << (glfwGetTime() - remeshStart) * 1000.0 << " ms, "
+				<< skippedBricks << " of " << bricks << " bricks skipped" << std::endl;
+		}
+		if(remeshing == 0)
+			ISOSTEP = 0;
+
 
 		if(WIREFRAME){
 			glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
@@ -165,25 +450,32 @@ int main(int argc, const char * argv[])
 
 		
 		// Draw to buffer
-		screenBuffer.bindBuffer();
+		{
+			PROFILE_SCOPE("scene pass");
+			screenBuffer.bindBuffer();
 		
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-		phong_shader();
-		phong_shader.updateCommonUniforms(rotator, W, H, glfwGetTime(), clear_color, lightDirection);
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+			phong_shader();
+			phong_shader.updateCommonUniforms(rotator, W, H, glfwGetTime(), clear_color, lightDirection);
 		
-		glDisable(GL_BLEND);
-		glDisable(GL_ALPHA_TEST);
+			glDisable(GL_BLEND);
+			glDisable(GL_ALPHA_TEST);
 		
-		for(unsigned i = 0; i < volumes.size(); i++)
-		{
-			volumes[i].draw();
+			// All cells in one draw call.
+			arena.resetFrameStats();
+			if(chunks)
+				chunks->update(rotator.target, rotator.cameraPosition());
+			arena.draw();
+
 			if(BOUNDINGBOXES)
 			{
-				glLineWidth(3.0);				
-				volumes[i].drawBoundingBox();
-				glLineWidth(1.0);								
+				glLineWidth(3.0);
+				for(unsigned i = 0; i < boundingBoxes.size(); i++)
+					boundingBoxes[i].draw();
+				glLineWidth(1.0);
 			}
 		}
+		const TerrainArena::FrameStats frameStats = arena.frameStats();
 		// Enable/disable fog
 		glUniform1i(fogLoc, FOG);
 		glUniform1i(crazyLoc, CRAZY);
@@ -195,25 +487,45 @@ int main(int argc, const char * argv[])
 		screenBuffer.bindTexture();		
 
 		// Draw to display
-		glBindFramebuffer(GL_FRAMEBUFFER, 0);
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);		
-		screen_shader();
-		glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+		{
+			PROFILE_SCOPE("screen pass");
+			glBindFramebuffer(GL_FRAMEBUFFER, 0);
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);		
+			screen_shader();
+			glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
 
 
-		screen_shader.updateCommonUniforms(rotator, W, H, glfwGetTime(), clear_color, lightDirection);
-		quad.draw();
+			screen_shader.updateCommonUniforms(rotator, W, H, glfwGetTime(), clear_color, lightDirection);
+			quad.draw();
+		}
 
-		glfwSwapBuffers(window);
+		{
+			PROFILE_SCOPE("swap buffers");
+			glfwSwapBuffers(window);
+		}
 		glfwPollEvents();
 
+		PROFILE_COUNTER("triangles drawn", frameStats.trianglesDrawn);
+		PROFILE_COUNTER("bytes uploaded", frameStats.bytesUploaded);
+		PROFILE_COUNTER("lock contention", pool.contention() + generatedCells.contention());
+
 		//Show fps in window title
 		double t = glfwGetTime();
+		lastFrameMs = (t - lastFrame) * 1000.0;
+		frameTimes.add(lastFrameMs);
+		lastFrame = t;
 		// If one second has passed, or if this is the very first frame
 		if ((t - t0) > 1.0 || frames == 0)
 		{
 			double fps = (double)frames / (t - t0);
-			sprintf(titlestring, "Procedurally generated marching cubes (%.1f fps)", fps);
+			int length = sprintf(titlestring, "Procedurally generated marching cubes (%.1f fps, frame ms p50 %.1f p95 %.1f p99 %.1f, %u draw calls, %.1f KB uploaded per frame)",
+				fps, frameTimes.percentile(50), frameTimes.percentile(95), frameTimes.percentile(99), frameStats.drawCalls, frameStats.bytesUploaded / 1024.0);
+			if(chunks)
+				sprintf(titlestring + length, " %u cells, %u loading, load ms p50 %.0f p95 %.0f",
+					chunks->residentChunks(), chunks->pendingChunks(), chunks->loadLatency().percentile(50), chunks->loadLatency().percentile(95));
+			else if(useLODs)
+				sprintf(titlestring + length, " %.1f px error, about %u triangles, %u cells re-meshing",
+					lods.currentPixelError(), (unsigned)lods.estimatedTriangles(), remeshing);
 			glfwSetWindowTitle(window, titlestring);
 			t0 = t;
 			frames = 0;
@@ -223,6 +535,31 @@ int main(int argc, const char * argv[])
 	} while (glfwGetKey(window, GLFW_KEY_ESCAPE) != GLFW_PRESS &&
 			 glfwWindowShouldClose(window) == 0);
 
+	// The jobs use the re-meshed cells, let them finish.
+	for(unsigned k; remeshing > 0; remeshing--)
+		remeshedCells.waitPop(k);
+
+	std::cout << "Frame time ms: p50 " << frameTimes.percentile(50) << ", p95 " << frameTimes.percentile(95) << ", p99 " << frameTimes.percentile(99) << std::endl;
+	if(chunks)
+		std::cout << "Cell load latency ms: p50 " << chunks->loadLatency().percentile(50) << ", p95 " << chunks->loadLatency().percentile(95)
+			<< ", p99 " << chunks->loadLatency().percentile(99) << std::endl;
+
+	if(cache)
+	{
+		const CellCache::Stats stats = cache->stats();
+		std::cout << "Cell cache: " << stats.hits << " hits, " << stats.misses << " misses, " << stats.evictions << " evicted, "
+			<< stats.bytesRead / (1024.0 * 1024.0) << " MB mapped, " << stats.bytesWritten / (1024.0 * 1024.0) << " MB written, "
+			<< stats.bytesStored / (1024.0 * 1024.0) << " MB stored" << std::endl;
+	}
+
+	if(tracePath)
+	{
+		if(Profiler::writeTrace(tracePath))
+			std::cout << "Trace written to " << tracePath << std::endl;
+		else
+			std::cerr << "Could not write the trace to " << tracePath << std::endl;
+	}
+
 	glDisableVertexAttribArray(0);
 
 	return 0;
@@ -1,8 +1,10 @@
 #version 430 core
 
-layout (location = 0) in vec3 position;
-layout (location = 1) in vec3 normal;
+layout (location = 0) in vec3 vertexPosition;
+layout (location = 1) in vec3 vertexNormal;
 layout (location = 2) in vec2 uv;
+// Origin (xyz) and quantum (w) of the cell's packed positions, see VertexFormat.
+layout (location = 3) in vec4 cellOrigin;
 
 out vec3 newPos;
 out vec3 newNormal;
@@ -13,6 +15,9 @@ uniform mat4 P;
 uniform float time;
 uniform float startTime;
 uniform int crazyEnabled;
+// Set by TerrainArena while it draws packed vertices: vertexPosition holds 16-bit
+// steps of the quantum and vertexNormal.xy octahedral coordinates.
+uniform int packedVertices;
 
 //
 // Description : Array and textureless GLSL 2D/3D/4D simplex 
@@ -119,9 +124,24 @@ float snoise(vec3 v)
   }
 
 
+// Unit vector from octahedral coordinates, as VertexFormat::decodeOctahedral.
+vec3 decodeOctahedral(vec2 e) {
+  vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+  float t = max(-n.z, 0.0);
+  n.xy += mix(vec2(t), vec2(-t), greaterThanEqual(n.xy, vec2(0.0)));
+  return normalize(n);
+}
 
 void main() {
 	
+  vec3 position = vertexPosition;
+  vec3 normal = vertexNormal;
+  if(packedVertices != 0)
+  {
+    position = cellOrigin.xyz + cellOrigin.w * position;
+    normal = decodeOctahedral(normal.xy);
+  }
+
   float scale = 0.1;
 
   float n1 = snoise(position * 0.5) * 0.5;
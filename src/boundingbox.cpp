@@ -0,0 +1,87 @@
+#include "boundingbox.h"
+
+// The twelve edges of the cube as pairs of corners, whose bits 4, 2 and 1 select the
+// high x, y and z side.
+static const unsigned boxIndices[] = {
+    0, 4, 1, 5, 2, 6, 3, 7,
+    0, 2, 1, 3, 4, 6, 5, 7,
+    0, 1, 2, 3, 4, 5, 6, 7
+};
+static const unsigned BOX_INDICES = sizeof(boxIndices) / sizeof(boxIndices[0]);
+
+// The box never changes, so it is uploaded once to immutable storage where available.
+static void uploadBuffer(const GLenum target, const size_t bytes, const void *data)
+{
+    if(GLEW_ARB_buffer_storage)
+        glBufferStorage(target, bytes, data, 0);
+    else
+        glBufferData(target, bytes, data, GL_STATIC_DRAW);
+}
+
+BoundingBox::BoundingBox(const glm::vec3 &center, const float size)
+: _VAO(0), _VBO(0), _EBO(0)
+{
+    glm::vec3 vertices[8];
+    for(unsigned v = 0; v < 8; v++)
+        vertices[v] = center + 0.5f * size * glm::vec3(v & 4 ? 1.0f : -1.0f, v & 2 ? 1.0f : -1.0f, v & 1 ? 1.0f : -1.0f);
+
+    glGenVertexArrays(1, &_VAO);
+    glGenBuffers(1, &_VBO);
+    glGenBuffers(1, &_EBO);
+    glBindVertexArray(_VAO);
+
+    glBindBuffer(GL_ARRAY_BUFFER, _VBO);
+    uploadBuffer(GL_ARRAY_BUFFER, sizeof(vertices), vertices);
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _EBO);
+    uploadBuffer(GL_ELEMENT_ARRAY_BUFFER, sizeof(boxIndices), boxIndices);
+
+    //Vertex position attribute
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (GLvoid*)0);
+    glEnableVertexAttribArray(0);
+
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
+}
+
+BoundingBox::~BoundingBox()
+{
+    release();
+}
+
+BoundingBox::BoundingBox(BoundingBox &&other)
+: _VAO(other._VAO), _VBO(other._VBO), _EBO(other._EBO)
+{
+    other._VAO = other._VBO = other._EBO = 0;
+}
+
+BoundingBox &BoundingBox::operator=(BoundingBox &&other)
+{
+    if(this != &other)
+    {
+        release();
+        _VAO = other._VAO;
+        _VBO = other._VBO;
+        _EBO = other._EBO;
+        other._VAO = other._VBO = other._EBO = 0;
+    }
+    return *this;
+}
+
+void BoundingBox::release()
+{
+    glDeleteVertexArrays(1, &_VAO);
+    glDeleteBuffers(1, &_VBO);
+    glDeleteBuffers(1, &_EBO);
+    _VAO = _VBO = _EBO = 0;
+}
+
+void BoundingBox::draw() const
+{
+    glDisable(GL_CULL_FACE);
+    glBindVertexArray(_VAO);
+
+    glDrawElements(GL_LINES, BOX_INDICES, GL_UNSIGNED_INT, 0);
+
+    glBindVertexArray(0);
+}
@@ -0,0 +1,129 @@
+#include "brickpyramid.h"
+
+#include <algorithm>
+#include <float.h>
+
+void BrickPyramid::build(const SampleVolume &data, const unsigned dim)
+{
+    const unsigned n = dim + 1;
+    const unsigned bricks = (dim + BRICK - 1) / BRICK;
+
+    _levels.assign(1, Level());
+    Level &base = _levels[0];
+    base.size = bricks;
+    base.min.assign((size_t)bricks * bricks * bricks, FLT_MAX);
+    base.max.assign((size_t)bricks * bricks * bricks, -FLT_MAX);
+
+    // Every thread fills whole x-slabs of bricks, so no brick is written by two threads.
+    #pragma omp parallel for schedule(dynamic)
+    for(int bx = 0; bx < (int)bricks; bx++)
+    {
+        std::vector<float> rowMin(bricks), rowMax(bricks);
+        const unsigned lastX = std::min((bx + 1) * BRICK, dim);
+
+        for(unsigned x = bx * BRICK; x <= lastX; x++)
+            for(unsigned y = 0; y < n; y++)
+            {
+                // Range of the samples of every z-brick in this row, shared faces included.
+                const float *row = data.row(x, y);
+                for(unsigned bz = 0; bz < bricks; bz++)
+                {
+                    const unsigned lastZ = std::min((bz + 1) * BRICK, dim);
+                    float lo = row[bz * BRICK], hi = lo;
+                    for(unsigned z = bz * BRICK + 1; z <= lastZ; z++)
+                    {
+                        lo = std::min(lo, row[z]);
+                        hi = std::max(hi, row[z]);
+                    }
+                    rowMin[bz] = lo;
+                    rowMax[bz] = hi;
+                }
+
+                // A row on the face between two y-bricks belongs to both.
+                const unsigned firstY = (y > 0 && y % BRICK == 0) ? y / BRICK - 1 : y / BRICK;
+                const unsigned lastY = std::min(y / BRICK, bricks - 1);
+                for(unsigned by = firstY; by <= lastY; by++)
+                    for(unsigned bz = 0; bz < bricks; bz++)
+                    {
+                        const size_t i = base.index(bx, by, bz);
+                        base.min[i] = std::min(base.min[i], rowMin[bz]);
+                        base.max[i] = std::max(base.max[i], rowMax[bz]);
+                    }
+            }
+    }
+
+    // Each level above merges up to 2x2x2 nodes of the one below.
+    while(_levels.back().size > 1)
+    {
+        Level coarse;
+        coarse.size = (_levels.back().size + 1) / 2;
+        coarse.min.assign((size_t)coarse.size * coarse.size * coarse.size, FLT_MAX);
+        coarse.max.assign((size_t)coarse.size * coarse.size * coarse.size, -FLT_MAX);
+
+        const Level &fine = _levels.back();
+        for(unsigned x = 0; x < fine.size; x++)
+            for(unsigned y = 0; y < fine.size; y++)
+                for(unsigned z = 0; z < fine.size; z++)
+                {
+                    const size_t i = fine.index(x, y, z);
+                    const size_t parent = coarse.index(x / 2, y / 2, z / 2);
+                    coarse.min[parent] = std::min(coarse.min[parent], fine.min[i]);
+                    coarse.max[parent] = std::max(coarse.max[parent], fine.max[i]);
+                }
+        _levels.push_back(coarse);
+    }
+}
+
+unsigned BrickPyramid::findActive(const float isovalue, std::vector<unsigned char> &active) const
+{
+    const unsigned bricks = bricksPerAxis();
+    active.assign((size_t)bricks * bricks * bricks, 0);
+    if(_levels.empty())
+        return 0;
+
+    struct Node
+    {
+        unsigned level, x, y, z;
+    };
+
+    // Depth first from the root, a node is only opened if its range straddles the isovalue.
+    unsigned count = 0;
+    std::vector<Node> stack;
+    const Node root = {(unsigned)_levels.size() - 1, 0, 0, 0};
+    stack.push_back(root);
+    while(!stack.empty())
+    {
+        const Node node = stack.back();
+        stack.pop_back();
+
+        const Level &level = _levels[node.level];
+        const size_t i = level.index(node.x, node.y, node.z);
+        if(!(level.max[i] > isovalue && level.min[i] <= isovalue))
+            continue;
+
+        if(node.level == 0)
+        {
+            active[i] = 1;
+            count++;
+            continue;
+        }
+
+        const unsigned below = _levels[node.level - 1].size;
+        for(unsigned x = 2 * node.x; x < std::min(2 * node.x + 2, below); x++)
+            for(unsigned y = 2 * node.y; y < std::min(2 * node.y + 2, below); y++)
+                for(unsigned z = 2 * node.z; z < std::min(2 * node.z + 2, below); z++)
+                {
+                    const Node child = {node.level - 1, x, y, z};
+                    stack.push_back(child);
+                }
+    }
+    return count;
+}
+
+size_t BrickPyramid::bytes() const
+{
+    size_t bytes = 0;
+    for(unsigned l = 0; l < _levels.size(); l++)
+        bytes += (_levels[l].min.capacity() + _levels[l].max.capacity()) * sizeof(float);
+    return bytes;
+}
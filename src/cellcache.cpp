@@ -0,0 +1,191 @@
+#include "cellcache.h"
+#include "profiler.h"
+
+#include <cstdio>
+#include <cstring>
+#include <dirent.h>
+#include <unistd.h>
+#include <utime.h>
+#include <sys/stat.h>
+
+CellCache::Key::Key()
+{
+    memset(this, 0, sizeof(Key));
+    generatorVersion = VoxelData::GENERATOR_VERSION;
+}
+
+CellCache::Key::Key(const VoxelData &volume, const float noiseScale, const float isovalue)
+{
+    memset(this, 0, sizeof(Key));
+    for(unsigned i = 0; i < 3; i++)
+        gridCenter[i] = volume.getGridCenter()[i];
+    gridSize = volume.getGridSize();
+    dim = volume.getDimension();
+    seamless = volume.isSeamless();
+    for(unsigned face = 0; face < 4; face++)
+        neighbourDimensions[face] = volume.getNeighbourDimension((VoxelData::Face)face);
+    for(unsigned corner = 0; corner < 4; corner++)
+        cornerDimensions[corner] = volume.getCornerDimension((VoxelData::Face)(corner >> 1), (VoxelData::Face)(VoxelData::FACE_LOW_Z + (corner & 1)));
+    this->noiseScale = noiseScale;
+    this->isovalue = isovalue;
+    generationMode = volume.getGenerationMode();
+    meshMode = volume.getMeshMode();
+    meshStrategy = volume.getMeshStrategy();
+    normalMode = volume.getNormalMode();
+    sampleFormat = volume.getSampleFormat();
+    generatorVersion = VoxelData::GENERATOR_VERSION;
+}
+
+uint64_t CellCache::hash(const Key &key)
+{
+    const unsigned char *bytes = (const unsigned char *)&key;
+    uint64_t h = 14695981039346656037ull;
+    for(size_t i = 0; i < sizeof(Key); i++)
+    {
+        h ^= bytes[i];
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+CellCache::CellCache(const std::string &directory, const size_t maxBytes)
+: _directory(directory), _maxBytes(maxBytes), _clock(0), _temporaryFiles(0)
+{
+    memset(&_stats, 0, sizeof(Stats));
+
+    // Files of earlier runs count as used when they were last written or hit.
+    DIR *dir = opendir(directory.c_str());
+    if(dir == NULL)
+        return;
+    while(dirent *file = readdir(dir))
+    {
+        const std::string name = file->d_name;
+        unsigned long long h;
+        char end;
+        struct stat info;
+        if(name.size() != 21 || sscanf(name.c_str(), "%16llx.cel%c", &h, &end) != 2 || end != 'l'
+            || stat((directory + "/" + name).c_str(), &info) != 0)
+            continue;
+        Entry entry;
+        entry.bytes = info.st_size;
+        entry.lastUse = info.st_mtime;
+        _entries[h] = entry;
+        _stats.bytesStored += entry.bytes;
+        _clock = std::max(_clock, entry.lastUse + 1);
+    }
+    closedir(dir);
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    evict(0);
+}
+
+std::string CellCache::path(const uint64_t hash) const
+{
+    char name[32];
+    sprintf(name, "/%016llx.cell", (unsigned long long)hash);
+    return _directory + name;
+}
+
+void CellCache::forget(const uint64_t hash)
+{
+    std::map<uint64_t, Entry>::iterator entry = _entries.find(hash);
+    if(entry == _entries.end())
+        return;
+    _stats.bytesStored -= entry->second.bytes;
+    _entries.erase(entry);
+}
+
+void CellCache::evict(const uint64_t keep)
+{
+    while(_stats.bytesStored > _maxBytes)
+    {
+        std::map<uint64_t, Entry>::iterator oldest = _entries.end();
+        for(std::map<uint64_t, Entry>::iterator entry = _entries.begin(); entry != _entries.end(); ++entry)
+            if(entry->first != keep && (oldest == _entries.end() || entry->second.lastUse < oldest->second.lastUse))
+                oldest = entry;
+        if(oldest == _entries.end())
+            return;
+        unlink(path(oldest->first).c_str());
+        _stats.evictions++;
+        forget(oldest->first);
+    }
+}
+
+std::unique_ptr<MeshFile> CellCache::load(const Key &key)
+{
+    PROFILE_SCOPE("cache load");
+    const uint64_t h = hash(key);
+    const std::string file = path(h);
+    std::unique_ptr<MeshFile> cell;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if(_entries.find(h) == _entries.end())
+        {
+            _stats.misses++;
+            return cell;
+        }
+    }
+
+    // Only a whole file for this very key is used.
+    cell.reset(new MeshFile());
+    const bool valid = cell->open(file) && cell->tagBytes() == sizeof(Key) && memcmp(cell->tag(), &key, sizeof(Key)) == 0;
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    if(!valid)
+    {
+        // Broken or from another version, make room for a good one.
+        cell.reset();
+        unlink(file.c_str());
+        forget(h);
+        _stats.misses++;
+        return cell;
+    }
+    std::map<uint64_t, Entry>::iterator entry = _entries.find(h);
+    if(entry != _entries.end())
+        entry->second.lastUse = _clock++;
+    utime(file.c_str(), NULL);
+    _stats.hits++;
+    _stats.bytesRead += cell->bytes();
+    PROFILE_COUNTER("cache hits", _stats.hits);
+    return cell;
+}
+
+bool CellCache::store(const Key &key, const std::vector<glm::vec3> &vertexData, const std::vector<glm::ivec3> &indices)
+{
+    PROFILE_SCOPE("cache store");
+    const uint64_t h = hash(key);
+
+    // Written under another name and renamed, so nobody maps half a file.
+    char suffix[48];
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        sprintf(suffix, ".%d.%u.tmp", (int)getpid(), _temporaryFiles++);
+    }
+    const std::string file = path(h);
+    const std::string temporary = file + suffix;
+    struct stat info;
+    if(!MeshFile::write(temporary, vertexData, indices, &key, sizeof(Key)) || stat(temporary.c_str(), &info) != 0
+        || rename(temporary.c_str(), file.c_str()) != 0)
+    {
+        unlink(temporary.c_str());
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    forget(h);
+    Entry entry;
+    entry.bytes = info.st_size;
+    entry.lastUse = _clock++;
+    _entries[h] = entry;
+    _stats.stores++;
+    _stats.bytesWritten += entry.bytes;
+    _stats.bytesStored += entry.bytes;
+    evict(h);
+    return true;
+}
+
+CellCache::Stats CellCache::stats() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _stats;
+}
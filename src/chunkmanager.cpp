@@ -0,0 +1,263 @@
+#include "chunkmanager.h"
+#include "profiler.h"
+
+#include <algorithm>
+
+ChunkManager::Settings::Settings()
+: dim(32), gridSize(0.5f), noiseScale(0.1f), isovalue(0.55f),
+  meshMode(VoxelData::MESH_INDEXED), normalMode(VoxelData::NORMALS_SOBEL),
+  generationMode(VoxelData::GENERATE_BOUNDED), sampleFormat(SampleVolume::FORMAT_FLOAT),
+  sampleStorage(SampleVolume::STORAGE_DENSE),
+  viewRadius(1.5f), maxChunks(64), maxGPUBytes(256 << 20),
+  uploadsPerFrame(2), maxInFlight(4), cache(NULL)
+{
+}
+
+ChunkManager::ChunkManager(TerrainArena &arena, JobPool &pool, const Settings &settings)
+: _arena(arena), _pool(pool), _settings(settings), _centerChunk(0, 0), _borderBytes(0), _jobs(0), _quit(false)
+{
+}
+
+ChunkManager::~ChunkManager()
+{
+    // Jobs that have not started return right away, wait for the running ones.
+    std::unique_lock<std::mutex> lock(_mutex);
+    _quit = true;
+    _jobsDone.wait(lock, [this] { return _jobs == 0; });
+}
+
+float ChunkManager::distance(const ChunkKey &key, const glm::vec3 &center) const
+{
+    const float dx = key.first * _settings.gridSize - center.x;
+    const float dz = key.second * _settings.gridSize - center.z;
+    return sqrtf(dx * dx + dz * dz);
+}
+
+bool ChunkManager::evictFarthest(const glm::vec3 &center, const float nearerThan)
+{
+    std::map<ChunkKey, unsigned>::iterator farthest = _resident.end();
+    float farthestDistance = nearerThan;
+    for(std::map<ChunkKey, unsigned>::iterator chunk = _resident.begin(); chunk != _resident.end(); ++chunk)
+    {
+        const float d = distance(chunk->first, center);
+        if(d > farthestDistance)
+        {
+            farthest = chunk;
+            farthestDistance = d;
+        }
+    }
+
+    if(farthest == _resident.end())
+        return false;
+    _arena.removeCell(farthest->second);
+    forgetBorders(farthest->first);
+    _resident.erase(farthest);
+    return true;
+}
+
+static size_t slabBytes(const std::array<std::shared_ptr<const std::vector<float> >, 4> &slabs)
+{
+    size_t bytes = 0;
+    for(unsigned face = 0; face < 4; face++)
+        if(slabs[face])
+            bytes += slabs[face]->size() * sizeof(float);
+    return bytes;
+}
+
+void ChunkManager::forgetBorders(const ChunkKey &key)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    std::map<ChunkKey, BorderSlabs>::iterator borders = _borders.find(key);
+    if(borders == _borders.end())
+        return;
+    _borderBytes -= slabBytes(borders->second);
+    _borders.erase(borders);
+}
+
+size_t ChunkManager::borderBytes()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _borderBytes;
+}
+
+void ChunkManager::update(const glm::vec3 &center, const glm::vec3 &eye)
+{
+    PROFILE_SCOPE("chunk update");
+    const float gridSize = _settings.gridSize;
+    const float keepRadius = _settings.viewRadius + gridSize;
+
+    const ChunkKey centerChunk((int)floorf(center.x / gridSize + 0.5f), (int)floorf(center.z / gridSize + 0.5f));
+    if(centerChunk != _centerChunk)
+    {
+        _centerChunk = centerChunk;
+        _skipped.clear();
+    }
+
+    // Evict the cells that are out of range.
+    for(std::map<ChunkKey, unsigned>::iterator chunk = _resident.begin(); chunk != _resident.end();)
+    {
+        if(distance(chunk->first, center) > keepRadius)
+        {
+            _arena.removeCell(chunk->second);
+            forgetBorders(chunk->first);
+            _resident.erase(chunk++);
+        }
+        else
+            ++chunk;
+    }
+
+    // Cancel requested cells that went out of range, their jobs skip them if they
+    // have not started yet.
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        for(std::set<ChunkKey>::iterator chunk = _inFlight.begin(); chunk != _inFlight.end(); ++chunk)
+            if(distance(*chunk, center) > keepRadius)
+                _cancelled.insert(*chunk);
+    }
+
+    // Upload a few of the finished cells.
+    for(unsigned u = 0; u < _settings.uploadsPerFrame; u++)
+    {
+        Result result;
+        if(!_results.tryPop(result))
+            break;
+        _inFlight.erase(result.key);
+
+        // Cancelled cells come back without a mesh.
+        const float d = distance(result.key, center);
+        if(d > keepRadius || result.requestTime < 0.0)
+        {
+            forgetBorders(result.key);
+            continue;
+        }
+
+        // Cells from the cache are uploaded straight from the mapped file.
+        const glm::vec3 *vertexData = result.mapped ? result.mapped->vertexData() : result.vertexData.data();
+        const size_t vertexDataSize = result.mapped ? result.mapped->vertexDataSize() : result.vertexData.size();
+        const glm::ivec3 *indices = result.mapped ? result.mapped->indices() : result.indices.data();
+        const size_t numberOfIndices = result.mapped ? result.mapped->numberOfIndices() : result.indices.size();
+
+        // Make room by evicting cells further away than this one. The border slabs of
+        // the cell are already counted, evicting a cell drops its slabs too.
+        const size_t bytes = _arena.cellBytes(vertexDataSize, numberOfIndices);
+        bool fits = true;
+        while(fits && (_arena.usedBytes() + borderBytes() + bytes > _settings.maxGPUBytes || _resident.size() >= _settings.maxChunks))
+            fits = evictFarthest(center, d);
+        if(!fits)
+        {
+            forgetBorders(result.key);
+            _skipped.insert(result.key);
+            continue;
+        }
+
+        _resident[result.key] = _arena.addCell(vertexData, vertexDataSize, indices, numberOfIndices);
+        _latency.add((glfwGetTime() - result.requestTime) * 1000.0);
+    }
+
+    // The cells in range that are missing, nearest to the eye first.
+    const int reach = (int)ceilf(_settings.viewRadius / gridSize);
+    std::vector<std::pair<float, ChunkKey> > missing;
+    for(int i = -reach; i <= reach; i++)
+        for(int j = -reach; j <= reach; j++)
+        {
+            const ChunkKey key(centerChunk.first + i, centerChunk.second + j);
+            if(distance(key, center) <= _settings.viewRadius && !_resident.count(key) && !_inFlight.count(key) && !_skipped.count(key))
+                missing.push_back(std::make_pair(distance(key, eye), key));
+        }
+    std::sort(missing.begin(), missing.end());
+
+    // Queue them while there is room, a cell only replaces cells further away.
+    const double now = glfwGetTime();
+    for(unsigned m = 0; m < missing.size() && _inFlight.size() < _settings.maxInFlight; m++)
+    {
+        const ChunkKey key = missing[m].second;
+        if(_resident.size() + _inFlight.size() >= _settings.maxChunks && !evictFarthest(center, distance(key, center)))
+            break;
+
+        _inFlight.insert(key);
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _cancelled.erase(key);
+            _jobs++;
+        }
+        _pool.submit([this, key, now] { generate(key, now); });
+    }
+}
+
+void ChunkManager::generate(const ChunkKey key, const double requestTime)
+{
+    PROFILE_SCOPE("chunk generate");
+    Result result;
+    result.key = key;
+    result.requestTime = -1.0;
+
+    bool cancelled;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        cancelled = _quit || _cancelled.erase(key) > 0;
+    }
+
+    if(!cancelled)
+    {
+        // Cells of the seamless layout, the one at (i, j) is centered at gridSize * (i, 0, j).
+        VoxelData volume(_settings.dim, _settings.gridSize, glm::ivec3(key.first, 0, key.second));
+        volume.setMeshMode(_settings.meshMode);
+        volume.setNormalMode(_settings.normalMode);
+        volume.setGenerationMode(_settings.generationMode, _settings.isovalue);
+        volume.setSampleFormat(_settings.sampleFormat, _settings.isovalue, _settings.sampleStorage);
+
+        // A cell cached by this or an earlier run is not generated at all. Its neighbours
+        // evaluate the samples they would have shared.
+        const CellCache::Key cacheKey(volume, _settings.noiseScale, _settings.isovalue);
+        if(_settings.cache)
+            result.mapped = _settings.cache->load(cacheKey);
+        if(!result.mapped)
+        {
+            // Take the samples shared with the neighbours that are already generated.
+            const ChunkKey neighbours[4] = {ChunkKey(key.first - 1, key.second), ChunkKey(key.first + 1, key.second),
+                ChunkKey(key.first, key.second - 1), ChunkKey(key.first, key.second + 1)};
+            BorderSlabs shared;
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                for(unsigned face = 0; face < 4; face++)
+                {
+                    std::map<ChunkKey, BorderSlabs>::const_iterator neighbour = _borders.find(neighbours[face]);
+                    if(neighbour != _borders.end())
+                        shared[face] = neighbour->second[VoxelData::oppositeFace((VoxelData::Face)face)];
+                }
+            }
+            for(unsigned face = 0; face < 4; face++)
+                if(shared[face])
+                    volume.setBorderSlab((VoxelData::Face)face, *shared[face]);
+
+            volume.generateData(_settings.noiseScale);
+
+            BorderSlabs borders;
+            for(unsigned face = 0; face < 4; face++)
+            {
+                std::shared_ptr<std::vector<float> > slab = std::make_shared<std::vector<float> >();
+                volume.getBorderSlab((VoxelData::Face)face, *slab);
+                borders[face] = slab;
+            }
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                BorderSlabs &stored = _borders[key];
+                _borderBytes += slabBytes(borders) - slabBytes(stored);
+                stored = borders;
+            }
+
+            volume.generateTriangles(_settings.isovalue);
+            if(_settings.cache)
+                _settings.cache->store(cacheKey, volume.getVertexData(), volume.getIndices());
+
+            result.vertexData = volume.getVertexData();
+            result.indices = volume.getIndices();
+        }
+        result.requestTime = requestTime;
+    }
+    _results.push(std::move(result));
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    _jobs--;
+    _jobsDone.notify_all();
+}
@@ -0,0 +1,179 @@
+#include "classify.h"
+
+#include <cstring>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define CLASSIFY_X86
+#include <immintrin.h>
+#endif
+
+// Classify the cubes z = first ... count - 1 one at a time.
+static inline unsigned classifyTail(const float *r00, const float *r01, const float *r11, const float *r10,
+    const unsigned first, const unsigned count, const float isovalue, unsigned char *cases, unsigned *active, unsigned activeCount)
+{
+    for (unsigned z = first; z < count; z++)
+    {
+        unsigned triangleConfiguration = 0;
+
+        // Compare the datapoints in one cube to the threshold.
+        if (r00[z] > isovalue) triangleConfiguration |= 1;
+        if (r01[z] > isovalue) triangleConfiguration |= 2;
+        if (r11[z] > isovalue) triangleConfiguration |= 4;
+        if (r10[z] > isovalue) triangleConfiguration |= 8;
+
+        if (r00[z+1] > isovalue) triangleConfiguration |= 16;
+        if (r01[z+1] > isovalue) triangleConfiguration |= 32;
+        if (r11[z+1] > isovalue) triangleConfiguration |= 64;
+        if (r10[z+1] > isovalue) triangleConfiguration |= 128;
+
+        cases[z] = triangleConfiguration;
+        if (triangleConfiguration != 0 && triangleConfiguration != 255)
+            active[activeCount++] = z;
+    }
+    return activeCount;
+}
+
+unsigned classifyCubesScalar(const float *r00, const float *r01, const float *r11, const float *r10,
+    const unsigned count, const float isovalue, unsigned char *cases, unsigned *active)
+{
+    return classifyTail(r00, r01, r11, r10, 0, count, isovalue, cases, active, 0);
+}
+
+#ifdef CLASSIFY_X86
+
+// Each corner comparison gives an all-ones lane where the sample is above the
+// isovalue. Masking it with the corner's bit and or-ing the eight corners gives
+// the case index of every lane, which is then narrowed to bytes.
+
+__attribute__((target("sse4.1")))
+unsigned classifyCubesSSE41(const float *r00, const float *r01, const float *r11, const float *r10,
+    const unsigned count, const float isovalue, unsigned char *cases, unsigned *active)
+{
+    const __m128 iso = _mm_set1_ps(isovalue);
+    const __m128i full = _mm_set1_epi32(255);
+    unsigned activeCount = 0;
+    unsigned z = 0;
+
+    for (; z + 4 <= count; z += 4)
+    {
+        __m128i c = _mm_and_si128(_mm_castps_si128(_mm_cmpgt_ps(_mm_loadu_ps(r00 + z), iso)), _mm_set1_epi32(1));
+        c = _mm_or_si128(c, _mm_and_si128(_mm_castps_si128(_mm_cmpgt_ps(_mm_loadu_ps(r01 + z), iso)), _mm_set1_epi32(2)));
+        c = _mm_or_si128(c, _mm_and_si128(_mm_castps_si128(_mm_cmpgt_ps(_mm_loadu_ps(r11 + z), iso)), _mm_set1_epi32(4)));
+        c = _mm_or_si128(c, _mm_and_si128(_mm_castps_si128(_mm_cmpgt_ps(_mm_loadu_ps(r10 + z), iso)), _mm_set1_epi32(8)));
+        c = _mm_or_si128(c, _mm_and_si128(_mm_castps_si128(_mm_cmpgt_ps(_mm_loadu_ps(r00 + z + 1), iso)), _mm_set1_epi32(16)));
+        c = _mm_or_si128(c, _mm_and_si128(_mm_castps_si128(_mm_cmpgt_ps(_mm_loadu_ps(r01 + z + 1), iso)), _mm_set1_epi32(32)));
+        c = _mm_or_si128(c, _mm_and_si128(_mm_castps_si128(_mm_cmpgt_ps(_mm_loadu_ps(r11 + z + 1), iso)), _mm_set1_epi32(64)));
+        c = _mm_or_si128(c, _mm_and_si128(_mm_castps_si128(_mm_cmpgt_ps(_mm_loadu_ps(r10 + z + 1), iso)), _mm_set1_epi32(128)));
+
+        __m128i bytes = _mm_packus_epi16(_mm_packus_epi32(c, c), _mm_setzero_si128());
+        const int packed = _mm_cvtsi128_si32(bytes);
+        memcpy(cases + z, &packed, sizeof(packed));
+
+        // Lanes that are neither case 0 nor case 255.
+        const __m128i empty = _mm_or_si128(_mm_cmpeq_epi32(c, _mm_setzero_si128()), _mm_cmpeq_epi32(c, full));
+        unsigned mask = ~_mm_movemask_ps(_mm_castsi128_ps(empty)) & 0xf;
+        while (mask)
+        {
+            active[activeCount++] = z + __builtin_ctz(mask);
+            mask &= mask - 1;
+        }
+    }
+
+    return classifyTail(r00, r01, r11, r10, z, count, isovalue, cases, active, activeCount);
+}
+
+__attribute__((target("avx2")))
+unsigned classifyCubesAVX2(const float *r00, const float *r01, const float *r11, const float *r10,
+    const unsigned count, const float isovalue, unsigned char *cases, unsigned *active)
+{
+    const __m256 iso = _mm256_set1_ps(isovalue);
+    const __m256i full = _mm256_set1_epi32(255);
+    unsigned activeCount = 0;
+    unsigned z = 0;
+
+    for (; z + 8 <= count; z += 8)
+    {
+        __m256i c = _mm256_and_si256(_mm256_castps_si256(_mm256_cmp_ps(_mm256_loadu_ps(r00 + z), iso, _CMP_GT_OQ)), _mm256_set1_epi32(1));
+        c = _mm256_or_si256(c, _mm256_and_si256(_mm256_castps_si256(_mm256_cmp_ps(_mm256_loadu_ps(r01 + z), iso, _CMP_GT_OQ)), _mm256_set1_epi32(2)));
+        c = _mm256_or_si256(c, _mm256_and_si256(_mm256_castps_si256(_mm256_cmp_ps(_mm256_loadu_ps(r11 + z), iso, _CMP_GT_OQ)), _mm256_set1_epi32(4)));
+        c = _mm256_or_si256(c, _mm256_and_si256(_mm256_castps_si256(_mm256_cmp_ps(_mm256_loadu_ps(r10 + z), iso, _CMP_GT_OQ)), _mm256_set1_epi32(8)));
+        c = _mm256_or_si256(c, _mm256_and_si256(_mm256_castps_si256(_mm256_cmp_ps(_mm256_loadu_ps(r00 + z + 1), iso, _CMP_GT_OQ)), _mm256_set1_epi32(16)));
+        c = _mm256_or_si256(c, _mm256_and_si256(_mm256_castps_si256(_mm256_cmp_ps(_mm256_loadu_ps(r01 + z + 1), iso, _CMP_GT_OQ)), _mm256_set1_epi32(32)));
+        c = _mm256_or_si256(c, _mm256_and_si256(_mm256_castps_si256(_mm256_cmp_ps(_mm256_loadu_ps(r11 + z + 1), iso, _CMP_GT_OQ)), _mm256_set1_epi32(64)));
+        c = _mm256_or_si256(c, _mm256_and_si256(_mm256_castps_si256(_mm256_cmp_ps(_mm256_loadu_ps(r10 + z + 1), iso, _CMP_GT_OQ)), _mm256_set1_epi32(128)));
+
+        const __m128i words = _mm_packus_epi32(_mm256_castsi256_si128(c), _mm256_extracti128_si256(c, 1));
+        _mm_storel_epi64((__m128i *)(cases + z), _mm_packus_epi16(words, words));
+
+        const __m256i empty = _mm256_or_si256(_mm256_cmpeq_epi32(c, _mm256_setzero_si256()), _mm256_cmpeq_epi32(c, full));
+        unsigned mask = ~_mm256_movemask_ps(_mm256_castsi256_ps(empty)) & 0xff;
+        while (mask)
+        {
+            active[activeCount++] = z + __builtin_ctz(mask);
+            mask &= mask - 1;
+        }
+    }
+
+    return classifyTail(r00, r01, r11, r10, z, count, isovalue, cases, active, activeCount);
+}
+
+bool classifySupportsSSE41()
+{
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("sse4.1");
+}
+
+bool classifySupportsAVX2()
+{
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+}
+
+#else
+
+// Without x86 intrinsics the wide versions fall back to the scalar one.
+
+unsigned classifyCubesSSE41(const float *r00, const float *r01, const float *r11, const float *r10,
+    const unsigned count, const float isovalue, unsigned char *cases, unsigned *active)
+{
+    return classifyCubesScalar(r00, r01, r11, r10, count, isovalue, cases, active);
+}
+
+unsigned classifyCubesAVX2(const float *r00, const float *r01, const float *r11, const float *r10,
+    const unsigned count, const float isovalue, unsigned char *cases, unsigned *active)
+{
+    return classifyCubesScalar(r00, r01, r11, r10, count, isovalue, cases, active);
+}
+
+bool classifySupportsSSE41() { return false; }
+bool classifySupportsAVX2() { return false; }
+
+#endif
+
+typedef unsigned (*ClassifyFunction)(const float *, const float *, const float *, const float *,
+    const unsigned, const float, unsigned char *, unsigned *);
+
+static ClassifyFunction selectClassifier()
+{
+    if (classifySupportsAVX2())
+        return classifyCubesAVX2;
+    if (classifySupportsSSE41())
+        return classifyCubesSSE41;
+    return classifyCubesScalar;
+}
+
+unsigned classifyCubes(const float *r00, const float *r01, const float *r11, const float *r10,
+    const unsigned count, const float isovalue, unsigned char *cases, unsigned *active)
+{
+    static const ClassifyFunction classify = selectClassifier();
+    return classify(r00, r01, r11, r10, count, isovalue, cases, active);
+}
+
+const char *classifyImplementation()
+{
+    if (classifySupportsAVX2())
+        return "avx2";
+    if (classifySupportsSSE41())
+        return "sse4.1";
+    return "scalar";
+}
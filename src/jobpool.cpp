@@ -0,0 +1,115 @@
+#include "jobpool.h"
+#include "profiler.h"
+
+#include <algorithm>
+#include <omp.h>
+
+// The pool and queue index of the worker running on this thread, if any.
+static thread_local JobPool *currentPool = NULL;
+static thread_local unsigned currentWorker = 0;
+
+JobPool::JobPool(unsigned threads)
+: _queued(0), _unfinished(0), _nextWorker(0), _contended(0), _quit(false)
+{
+    if(threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+
+    for(unsigned i = 0; i < threads; i++)
+        _workers.push_back(std::unique_ptr<Worker>(new Worker()));
+    for(unsigned i = 0; i < threads; i++)
+        _threads.push_back(std::thread(&JobPool::run, this, i));
+}
+
+JobPool::~JobPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _quit = true;
+    }
+    _wake.notify_all();
+    for(unsigned i = 0; i < _threads.size(); i++)
+        _threads[i].join();
+}
+
+void JobPool::submit(const Job &job)
+{
+    const unsigned index = currentPool == this ? currentWorker : _nextWorker++ % _workers.size();
+    _unfinished++;
+    {
+        std::unique_lock<std::mutex> lock = lockCounted(_workers[index]->mutex, _contended);
+        _workers[index]->jobs.push_back(job);
+    }
+
+    // Count the job under the lock the sleeping workers check it with.
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _queued++;
+    }
+    _wake.notify_one();
+}
+
+void JobPool::wait()
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+    _idle.wait(lock, [this] { return _unfinished == 0; });
+}
+
+bool JobPool::pop(const unsigned index, Job &job)
+{
+    // Newest job of our own queue first, then the oldest job of the others.
+    for(unsigned k = 0; k < _workers.size(); k++)
+    {
+        Worker &worker = *_workers[(index + k) % _workers.size()];
+        std::unique_lock<std::mutex> lock = lockCounted(worker.mutex, _contended);
+        if(worker.jobs.empty())
+            continue;
+
+        if(k == 0)
+        {
+            job = std::move(worker.jobs.back());
+            worker.jobs.pop_back();
+        }
+        else
+        {
+            job = std::move(worker.jobs.front());
+            worker.jobs.pop_front();
+        }
+        _queued--;
+        return true;
+    }
+    return false;
+}
+
+void JobPool::run(const unsigned index)
+{
+    currentPool = this;
+    currentWorker = index;
+    Profiler::setThreadName("worker " + std::to_string(index));
+
+    // Jobs run side by side, so the OpenMP loops inside them stay on this thread.
+    omp_set_num_threads(1);
+
+    while(true)
+    {
+        Job job;
+        if(!pop(index, job))
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _wake.wait(lock, [this] { return _quit || _queued > 0; });
+            if(_quit)
+                return;
+            continue;
+        }
+
+        {
+            PROFILE_SCOPE("job");
+            job();
+        }
+
+        if(--_unfinished == 0)
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _idle.notify_all();
+        }
+    }
+}
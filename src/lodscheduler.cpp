@@ -0,0 +1,212 @@
+#include "lodscheduler.h"
+#include "profiler.h"
+
+#include <algorithm>
+
+// The step to the neighbour across each face, in the order of VoxelData::Face.
+static const glm::ivec2 FACE_STEPS[4] = {glm::ivec2(-1, 0), glm::ivec2(1, 0), glm::ivec2(0, -1), glm::ivec2(0, 1)};
+
+// How fast the error allowed grows while over the triangle budget, and how far. At
+// most about the error of a cell the camera is inside of.
+static const float BUDGET_SCALE_STEP = 1.25f;
+static const float BUDGET_MAX_SCALE = 1e6f;
+
+LodScheduler::Settings::Settings()
+: dim(100), gridSize(0.5f), levels(4), focalLength(1000.0f),
+  pixelError(4.0f), hysteresis(0.75f), triangleBudget(0),
+  targetFrameMs(0.0), maxErrorScale(8.0f)
+{
+}
+
+LodScheduler::LodScheduler(const Settings &settings, const int cellGrid)
+: _settings(settings), _half(cellGrid / 2), _side(cellGrid / 2 * 2 + 1), _levels(1), _errorScale(1.0f), _frameMs(0.0)
+{
+    // Coarser levels halve the dim, as long as it divides and leaves a few samples.
+    while(_levels < settings.levels && settings.dim % (2u << (_levels - 1)) == 0 && (settings.dim >> _levels) >= 4)
+        _levels++;
+
+    _level.assign(_side * _side, 0);
+    _triangles.assign(_side * _side, 0);
+    _measuredLevel.assign(_side * _side, 0);
+}
+
+glm::ivec2 LodScheduler::cellPosition(const unsigned cell) const
+{
+    return glm::ivec2((int)cell / _side - _half, (int)cell % _side - _half);
+}
+
+unsigned LodScheduler::neighbourDimension(const unsigned cell, const unsigned face) const
+{
+    const glm::ivec2 p = cellPosition(cell) + FACE_STEPS[face];
+    if(abs(p.x) > _half || abs(p.y) > _half)
+        return 0;
+    return dimension((p.x + _half) * _side + p.y + _half);
+}
+
+unsigned LodScheduler::cornerDimension(const unsigned cell, const unsigned xFace, const unsigned zFace) const
+{
+    const glm::ivec2 p = cellPosition(cell) + FACE_STEPS[xFace] + FACE_STEPS[zFace];
+    if(abs(p.x) > _half || abs(p.y) > _half)
+        return 0;
+    return dimension((p.x + _half) * _side + p.y + _half);
+}
+
+void LodScheduler::reportTriangles(const unsigned cell, const unsigned triangles)
+{
+    _triangles[cell] = triangles;
+    _measuredLevel[cell] = _level[cell];
+}
+
+float LodScheduler::projectedError(const unsigned cell, const unsigned level, const glm::vec3 &camera) const
+{
+    // Distance to the cell's box, centered on its position like the meshes are.
+    const float gridSize = _settings.gridSize;
+    const glm::ivec2 p = cellPosition(cell);
+    const glm::vec3 low = glm::vec3(p.x - 0.5f, -0.5f, p.y - 0.5f) * gridSize;
+    const glm::vec3 high = low + glm::vec3(gridSize);
+    const glm::vec3 nearest = glm::clamp(camera, low, high);
+    const float distance = std::max(glm::length(camera - nearest), 1e-3f * gridSize);
+
+    const float spacing = gridSize * (float)(1u << level) / (float)_settings.dim;
+    return spacing * _settings.focalLength / distance;
+}
+
+size_t LodScheduler::estimateTriangles(const unsigned cell, const unsigned level) const
+{
+    // The surface is a sheet, its triangles go with the square of the dim. Cells not
+    // meshed yet are guessed as one flat sheet.
+    if(_triangles[cell] == 0)
+    {
+        const size_t dim = _settings.dim >> level;
+        return 2 * dim * dim;
+    }
+    const unsigned measured = _measuredLevel[cell];
+    if(level >= measured)
+        return _triangles[cell] >> (2 * (level - measured));
+    return (size_t)_triangles[cell] << (2 * (measured - level));
+}
+
+size_t LodScheduler::estimatedTriangles() const
+{
+    size_t total = 0;
+    for(unsigned cell = 0; cell < _level.size(); cell++)
+        total += estimateTriangles(cell, _level[cell]);
+    return total;
+}
+
+void LodScheduler::chooseLevels(const glm::vec3 &camera, const float allowed, std::vector<unsigned> &levels) const
+{
+    // Finer as soon as the error is too large, coarser only when it is well below.
+    levels = _level;
+    for(unsigned cell = 0; cell < levels.size(); cell++)
+    {
+        unsigned level = levels[cell];
+        if(projectedError(cell, level, camera) > allowed)
+            while(level > 0 && projectedError(cell, level, camera) > allowed)
+                level--;
+        else
+            while(level + 1 < _levels && projectedError(cell, level + 1, camera) < allowed * _settings.hysteresis)
+                level++;
+        levels[cell] = level;
+    }
+
+    // The borders between cells can only be bent across one level, so cells more than
+    // one level coarser than a neighbour are refined. A cell across a corner that is
+    // coarser than both cells beside that corner is refined too, the corner edge would
+    // be bent differently by the cells around it (see VoxelData::setNeighbourDimension).
+    for(bool changed = true; changed;)
+    {
+        changed = false;
+        for(unsigned cell = 0; cell < levels.size(); cell++)
+        {
+            const glm::ivec2 p = cellPosition(cell);
+            for(int di = -1; di <= 1; di++)
+                for(int dj = -1; dj <= 1; dj++)
+                {
+                    const glm::ivec2 q = p + glm::ivec2(di, dj);
+                    if(abs(q.x) > _half || abs(q.y) > _half)
+                        continue;
+                    const unsigned neighbour = levels[(q.x + _half) * _side + q.y + _half];
+                    if(levels[cell] > neighbour + 1)
+                    {
+                        levels[cell] = neighbour + 1;
+                        changed = true;
+                    }
+                    if(di == 0 || dj == 0)
+                        continue;
+                    const unsigned besideI = levels[(q.x + _half) * _side + p.y + _half];
+                    const unsigned besideJ = levels[(p.x + _half) * _side + q.y + _half];
+                    if(levels[cell] > besideI && levels[cell] > besideJ)
+                    {
+                        levels[cell] = std::max(besideI, besideJ);
+                        changed = true;
+                    }
+                }
+        }
+    }
+}
+
+bool LodScheduler::update(const glm::vec3 &camera, const double frameMs, std::vector<unsigned> &remesh)
+{
+    PROFILE_SCOPE("lod update");
+    remesh.clear();
+
+    // Follow the frame time slowly, a few percent of error per update.
+    if(_settings.targetFrameMs > 0.0 && frameMs > 0.0)
+    {
+        _frameMs = _frameMs > 0.0 ? 0.9 * _frameMs + 0.1 * frameMs : frameMs;
+        if(_frameMs > _settings.targetFrameMs)
+            _errorScale = std::min(_errorScale * 1.1f, _settings.maxErrorScale);
+        else if(_frameMs < 0.75 * _settings.targetFrameMs)
+            _errorScale = std::max(_errorScale / 1.1f, 1.0f);
+    }
+    const float allowed = currentPixelError();
+
+    std::vector<unsigned> levels;
+    chooseLevels(camera, allowed, levels);
+
+    // Over the budget, allow more error until the estimate fits. Coarsening single
+    // cells would leave them coarser than the cells beside their corners, raising the
+    // error coarsens whole rings where it shows the least first and keeps the rules above.
+    if(_settings.triangleBudget > 0)
+    {
+        float scale = 1.0f;
+        while(true)
+        {
+            size_t total = 0;
+            bool coarsest = true;
+            for(unsigned cell = 0; cell < levels.size(); cell++)
+            {
+                total += estimateTriangles(cell, levels[cell]);
+                coarsest = coarsest && levels[cell] + 1 == _levels;
+            }
+            if(total <= _settings.triangleBudget || coarsest || scale > BUDGET_MAX_SCALE)
+                break;
+            scale *= BUDGET_SCALE_STEP;
+            chooseLevels(camera, allowed * scale, levels);
+        }
+    }
+
+    // The changed cells and the ones around them.
+    std::vector<unsigned char> marked(levels.size(), 0);
+    for(unsigned cell = 0; cell < levels.size(); cell++)
+    {
+        if(levels[cell] == _level[cell])
+            continue;
+        const glm::ivec2 p = cellPosition(cell);
+        for(int di = -1; di <= 1; di++)
+            for(int dj = -1; dj <= 1; dj++)
+            {
+                const glm::ivec2 q = p + glm::ivec2(di, dj);
+                if(abs(q.x) <= _half && abs(q.y) <= _half)
+                    marked[(q.x + _half) * _side + q.y + _half] = 1;
+            }
+    }
+    for(unsigned cell = 0; cell < levels.size(); cell++)
+        if(marked[cell])
+            remesh.push_back(cell);
+
+    _level.swap(levels);
+    PROFILE_COUNTER("lod pixel error", allowed);
+    return !remesh.empty();
+}
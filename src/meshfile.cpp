@@ -0,0 +1,171 @@
+#include "meshfile.h"
+#include "profiler.h"
+
+#include <cstdio>
+#include <cstring>
+#include <cfloat>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+static const char MAGIC[8] = {'T', 'S', 'B', 'K', 'M', 'E', 'S', 'H'};
+
+static uint64_t alignUp(const uint64_t bytes)
+{
+    return (bytes + MeshFile::ALIGNMENT - 1) / MeshFile::ALIGNMENT * MeshFile::ALIGNMENT;
+}
+
+// Writes the bytes and pads them with zeros up to offset.
+static bool writeBlock(FILE *file, const void *data, const size_t bytes, const uint64_t offset)
+{
+    static const char zeros[MeshFile::ALIGNMENT] = {0};
+    if(bytes > 0 && fwrite(data, 1, bytes, file) != bytes)
+        return false;
+    const long position = ftell(file);
+    return position >= 0 && (uint64_t)position <= offset && fwrite(zeros, 1, offset - position, file) == offset - position;
+}
+
+bool MeshFile::write(const std::string &path, const std::vector<glm::vec3> &vertexData, const std::vector<glm::ivec3> &indices,
+    const void *tag, const size_t tagBytes)
+{
+    PROFILE_SCOPE("mesh file write");
+    Header header;
+    memset(&header, 0, sizeof(Header));
+    memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.headerBytes = sizeof(Header);
+    header.vertexBytes = 2 * sizeof(glm::vec3);
+    header.triangleBytes = sizeof(glm::ivec3);
+    header.tagOffset = alignUp(sizeof(Header));
+    header.tagBytes = tagBytes;
+    header.vertexOffset = alignUp(header.tagOffset + tagBytes);
+    header.numberOfVertices = vertexData.size() / 2;
+    header.indexOffset = alignUp(header.vertexOffset + header.vertexBytes * header.numberOfVertices);
+    header.numberOfTriangles = indices.size();
+    header.fileBytes = header.indexOffset + header.triangleBytes * header.numberOfTriangles;
+
+    glm::vec3 low(FLT_MAX), high(-FLT_MAX);
+    for(size_t v = 0; v < vertexData.size(); v += 2)
+    {
+        low = glm::min(low, vertexData[v]);
+        high = glm::max(high, vertexData[v]);
+    }
+    if(vertexData.empty())
+        low = high = glm::vec3(0.0f);
+    for(unsigned i = 0; i < 3; i++)
+    {
+        header.boundsMin[i] = low[i];
+        header.boundsMax[i] = high[i];
+    }
+
+    FILE *file = fopen(path.c_str(), "wb");
+    if(file == NULL)
+        return false;
+    bool written = writeBlock(file, &header, sizeof(Header), header.tagOffset)
+        && writeBlock(file, tag, tagBytes, header.vertexOffset)
+        && writeBlock(file, vertexData.data(), header.vertexBytes * header.numberOfVertices, header.indexOffset)
+        && writeBlock(file, indices.data(), header.triangleBytes * header.numberOfTriangles, header.fileBytes);
+    written = fclose(file) == 0 && written;
+    return written;
+}
+
+MeshFile::MeshFile()
+: _address(NULL), _length(0), _header(NULL), _tag(NULL), _vertexData(NULL), _indices(NULL)
+{
+}
+
+MeshFile::~MeshFile()
+{
+    close();
+}
+
+void MeshFile::close()
+{
+    if(_address)
+        munmap(_address, _length);
+    _address = NULL;
+    _length = 0;
+    _header = NULL;
+    _tag = NULL;
+    _vertexData = NULL;
+    _indices = NULL;
+}
+
+bool MeshFile::fail(const std::string &error)
+{
+    close();
+    _error = error;
+    return false;
+}
+
+// Whether count items of the given size from offset lie inside a file of length bytes.
+static bool inside(const uint64_t offset, const uint64_t count, const uint64_t size, const uint64_t length)
+{
+    return offset % MeshFile::ALIGNMENT == 0 && offset <= length && count <= (length - offset) / size;
+}
+
+bool MeshFile::open(const std::string &path, const bool checkIndices)
+{
+    PROFILE_SCOPE("mesh file open");
+    close();
+    _error.clear();
+
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if(fd < 0)
+        return fail("cannot open " + path);
+    struct stat info;
+    void *address = MAP_FAILED;
+    if(fstat(fd, &info) == 0 && info.st_size > 0)
+        address = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if(address == MAP_FAILED)
+        return fail("cannot map " + path);
+    _address = address;
+    _length = info.st_size;
+
+    if(_length < sizeof(Header))
+        return fail("shorter than a header");
+    const Header &header = *(const Header *)_address;
+    if(memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0)
+        return fail("not a mesh file");
+    if(header.version != VERSION || header.headerBytes != sizeof(Header))
+        return fail("another version of the format");
+    if(header.vertexBytes != 2 * sizeof(glm::vec3) || header.triangleBytes != sizeof(glm::ivec3))
+        return fail("another vertex or triangle layout");
+    if(header.fileBytes != _length)
+        return fail("not the length the header gives, the file is cut short or grown");
+    if(!inside(header.tagOffset, header.tagBytes, 1, _length) || !inside(header.vertexOffset, header.numberOfVertices, header.vertexBytes, _length)
+        || !inside(header.indexOffset, header.numberOfTriangles, header.triangleBytes, _length))
+        return fail("a block is outside the file");
+
+    const char *base = (const char *)_address;
+    _header = &header;
+    _tag = base + header.tagOffset;
+    _vertexData = (const glm::vec3 *)(base + header.vertexOffset);
+    _indices = (const glm::ivec3 *)(base + header.indexOffset);
+
+    if(checkIndices)
+    {
+        // Compared as unsigned, so negative indices are out of range too.
+        const uint32_t vertices = header.numberOfVertices;
+        const uint32_t *index = (const uint32_t *)_indices;
+        uint32_t largest = 0;
+        for(size_t i = 0; i < 3 * header.numberOfTriangles; i++)
+            largest = std::max(largest, index[i]);
+        if(header.numberOfTriangles > 0 && (header.numberOfVertices > UINT32_MAX || largest >= vertices))
+            return fail("an index is past the last vertex");
+    }
+    return true;
+}
+
+glm::vec3 MeshFile::boundsMin() const
+{
+    return _header ? glm::vec3(_header->boundsMin[0], _header->boundsMin[1], _header->boundsMin[2]) : glm::vec3(0.0f);
+}
+
+glm::vec3 MeshFile::boundsMax() const
+{
+    return _header ? glm::vec3(_header->boundsMax[0], _header->boundsMax[1], _header->boundsMax[2]) : glm::vec3(0.0f);
+}
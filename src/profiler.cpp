@@ -0,0 +1,147 @@
+#include "profiler.h"
+
+#include <fstream>
+#include <iomanip>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <chrono>
+
+std::atomic<bool> Profiler::_enabled(false);
+
+// A thread stops recording after this many events, so a long session cannot run
+// out of memory. The dropped events are counted in the trace.
+static const size_t MAX_EVENTS_PER_THREAD = 1 << 20;
+
+namespace
+{
+    struct Event
+    {
+        const char *name;
+        double start;
+        // Duration of a scope, or the value of a counter.
+        double value;
+        bool isCounter;
+    };
+
+    // The lock is only contended while the trace is written.
+    struct ThreadEvents
+    {
+        std::mutex mutex;
+        std::vector<Event> events;
+        std::string name;
+        unsigned id;
+        size_t dropped;
+    };
+}
+
+static const std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+
+// Buffers outlive their threads, so the events of finished workers are kept.
+static std::mutex registryMutex;
+static std::vector<std::shared_ptr<ThreadEvents> > registry;
+static thread_local std::shared_ptr<ThreadEvents> threadEvents;
+
+static ThreadEvents &currentThread()
+{
+    if(!threadEvents)
+    {
+        threadEvents = std::make_shared<ThreadEvents>();
+        threadEvents->dropped = 0;
+
+        std::lock_guard<std::mutex> lock(registryMutex);
+        threadEvents->id = registry.size();
+        registry.push_back(threadEvents);
+    }
+    return *threadEvents;
+}
+
+static void record(const Event &event)
+{
+    ThreadEvents &thread = currentThread();
+    std::lock_guard<std::mutex> lock(thread.mutex);
+    if(thread.events.size() < MAX_EVENTS_PER_THREAD)
+        thread.events.push_back(event);
+    else
+        thread.dropped++;
+}
+
+void Profiler::setEnabled(const bool enabled)
+{
+    _enabled.store(enabled, std::memory_order_relaxed);
+}
+
+void Profiler::setThreadName(const std::string &name)
+{
+    ThreadEvents &thread = currentThread();
+    std::lock_guard<std::mutex> lock(thread.mutex);
+    thread.name = name;
+}
+
+double Profiler::now()
+{
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - startTime).count();
+}
+
+void Profiler::complete(const char *name, const double start, const double end)
+{
+    const Event event = {name, start, end - start, false};
+    record(event);
+}
+
+void Profiler::counter(const char *name, const double value)
+{
+    const Event event = {name, now(), value, true};
+    record(event);
+}
+
+void Profiler::clear()
+{
+    std::lock_guard<std::mutex> lock(registryMutex);
+    for(unsigned t = 0; t < registry.size(); t++)
+    {
+        std::lock_guard<std::mutex> threadLock(registry[t]->mutex);
+        registry[t]->events.clear();
+        registry[t]->dropped = 0;
+    }
+}
+
+bool Profiler::writeTrace(const std::string &path)
+{
+    std::ofstream file(path.c_str());
+    if(!file)
+        return false;
+
+    file << std::fixed << std::setprecision(3);
+    file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+
+    bool first = true;
+    size_t dropped = 0;
+    std::lock_guard<std::mutex> lock(registryMutex);
+    for(unsigned t = 0; t < registry.size(); t++)
+    {
+        ThreadEvents &thread = *registry[t];
+        std::lock_guard<std::mutex> threadLock(thread.mutex);
+        dropped += thread.dropped;
+
+        if(!thread.name.empty())
+        {
+            file << (first ? "" : ",") << "\n{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":" << thread.id
+                << ",\"args\":{\"name\":\"" << thread.name << "\"}}";
+            first = false;
+        }
+
+        for(unsigned e = 0; e < thread.events.size(); e++)
+        {
+            const Event &event = thread.events[e];
+            file << (first ? "" : ",") << "\n{\"name\":\"" << event.name << "\",\"pid\":1,\"tid\":" << thread.id << ",\"ts\":" << event.start;
+            if(event.isCounter)
+                file << ",\"ph\":\"C\",\"args\":{\"value\":" << event.value << "}}";
+            else
+                file << ",\"ph\":\"X\",\"dur\":" << event.value << "}";
+            first = false;
+        }
+    }
+    file << "\n],\"otherData\":{\"droppedEvents\":" << dropped << "}}\n";
+    return (bool)file;
+}
@@ -1,5 +1,7 @@
 #include "rotator.h"
 
+#include <glm/gtc/matrix_transform.hpp>
+
 void KeyTranslator::init(GLFWwindow *window) {
 	horizontal = 0.0;
 	zoom = 0.0;
@@ -43,6 +45,9 @@ void MouseRotator::init(GLFWwindow *window) {
 	glfwGetCursorPos(window, &lastX, &lastY);
 	lastLeft = GL_FALSE;
 	lastRight = GL_FALSE;
+	target = glm::vec3(0.0f);
+	speed = 1.0f;
+	lastTime = glfwGetTime();
 }
 
 void MouseRotator::poll(GLFWwindow *window) {
@@ -100,4 +105,29 @@ void MouseRotator::poll(GLFWwindow *window) {
 	lastMiddle = currentMiddle;
 	lastX = currentX;
 	lastY = currentY;
+
+	// Fly over the ground, forward is where the camera looks.
+	double currentTime = glfwGetTime();
+	float step = speed * (currentTime - lastTime);
+	lastTime = currentTime;
+	if (glfwGetKey(window, GLFW_KEY_LEFT_SHIFT)) step *= 4.0f;
+
+	glm::vec3 forward = target - cameraPosition();
+	forward.y = 0.0f;
+	if (glm::length(forward) > 0.0f) {
+		forward = glm::normalize(forward);
+		glm::vec3 right = glm::cross(forward, glm::vec3(0.0f, 1.0f, 0.0f));
+		if (glfwGetKey(window, GLFW_KEY_W)) target += forward * step;
+		if (glfwGetKey(window, GLFW_KEY_S)) target -= forward * step;
+		if (glfwGetKey(window, GLFW_KEY_D)) target += right * step;
+		if (glfwGetKey(window, GLFW_KEY_A)) target -= right * step;
+	}
+}
+
+glm::vec3 MouseRotator::cameraPosition() const {
+	glm::mat4 M = glm::mat4(1.0f);
+	glm::mat4 VRotX = glm::rotate(M, phi, glm::vec3(0.0f, 1.0f, 0.0f)); //Rotation about y-axis
+	glm::mat4 VRotY = glm::rotate(M, theta, glm::vec3(1.0f, 0.0f, 0.0f)); //Rotation about x-axis
+	glm::vec4 camPos = VRotX * VRotY * glm::vec4(transX, 0.0f, 150.0f + zoom, 1.0f);
+	return glm::vec3(camPos) + target;
 }
\ No newline at end of file
@@ -0,0 +1,387 @@
+#include "samplevolume.h"
+
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+
+// Codes on each side of the center, the unorm codes below them read back below it.
+static const double UNORM16_HALF = 32768.0;
+static const double UNORM8_HALF = 128.0;
+
+static float halfToFloat(const uint16_t half)
+{
+    const uint32_t sign = (uint32_t)(half & 0x8000) << 16;
+    const uint32_t exponent = (half >> 10) & 0x1f;
+    const uint32_t mantissa = half & 0x3ff;
+    uint32_t bits;
+    if(exponent == 0x1f)
+        bits = sign | 0x7f800000 | (mantissa << 13);
+    else if(exponent != 0)
+        bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+    else
+    {
+        // Zero or subnormal, mantissa * 2^-24 is exact in a float.
+        const float magnitude = mantissa * (1.0f / 16777216.0f);
+        memcpy(&bits, &magnitude, sizeof(bits));
+        bits |= sign;
+    }
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+// Rounds to the nearest half float, ties to even.
+static uint16_t floatToHalf(const float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    const uint16_t sign = (bits >> 16) & 0x8000;
+    const uint32_t magnitude = bits & 0x7fffffff;
+
+    if(magnitude > 0x7f800000)
+        return sign | 0x7e00;
+    // From halfway between the largest half (65504) and 65536 up.
+    if(magnitude >= 0x477ff000)
+        return sign | 0x7c00;
+    // Below the smallest normal half, 2^-14, count steps of 2^-24. Rounding up to
+    // 1024 steps gives the smallest normal half's bits.
+    if(magnitude < 0x38800000)
+    {
+        float scaled;
+        memcpy(&scaled, &magnitude, sizeof(scaled));
+        return sign | (uint16_t)lrintf(scaled * 16777216.0f);
+    }
+
+    // Rebias the exponent and round away the low 13 bits of the mantissa, a carry
+    // moves on into the exponent.
+    uint32_t half = (magnitude - 0x38000000) >> 13;
+    const uint32_t rest = magnitude & 0x1fff;
+    if(rest > 0x1000 || (rest == 0x1000 && (half & 1)))
+        half++;
+    return sign | (uint16_t)half;
+}
+
+// The distance from the center of the middle of every code's range, in widths.
+static std::vector<float> companding(const unsigned codes)
+{
+    const float half = 0.5f * codes;
+    std::vector<float> table(codes);
+    for(unsigned c = 0; c < codes; c++)
+    {
+        const float g = ((float)c + 0.5f - half) / half;
+        table[c] = g / (1.0f - fabsf(g));
+    }
+    return table;
+}
+
+static const float *decodeTable(const SampleVolume::Format format)
+{
+    static const std::vector<float> unorm16 = companding(65536), unorm8 = companding(256);
+    static const std::vector<float> halves = []()
+    {
+        std::vector<float> table(65536);
+        for(unsigned c = 0; c < table.size(); c++)
+            table[c] = halfToFloat(c);
+        return table;
+    }();
+
+    switch(format)
+    {
+    case SampleVolume::FORMAT_HALF:
+        return halves.data();
+    case SampleVolume::FORMAT_UNORM16:
+        return unorm16.data();
+    case SampleVolume::FORMAT_UNORM8:
+        return unorm8.data();
+    default:
+        return NULL;
+    }
+}
+
+const char *SampleVolume::name(const Format format)
+{
+    switch(format)
+    {
+    case FORMAT_HALF:
+        return "half";
+    case FORMAT_UNORM16:
+        return "unorm16";
+    case FORMAT_UNORM8:
+        return "unorm8";
+    default:
+        return "float";
+    }
+}
+
+size_t SampleVolume::sampleBytes(const Format format)
+{
+    switch(format)
+    {
+    case FORMAT_HALF:
+    case FORMAT_UNORM16:
+        return sizeof(uint16_t);
+    case FORMAT_UNORM8:
+        return sizeof(uint8_t);
+    default:
+        return sizeof(float);
+    }
+}
+
+SampleVolume::SampleVolume()
+: _format(FORMAT_FLOAT), _storage(STORAGE_DENSE), _center(0.0f), _width(1.0f), _apron(0), _rowStride(0), _table(NULL),
+  _bricksX(0), _bricksY(0), _bricksZ(0), _storedBricks(0)
+{
+}
+
+void SampleVolume::resize(const unsigned nx, const unsigned ny, const unsigned nz, const unsigned apron,
+    const Format format, const float center, const float width, const Storage storage)
+{
+    // Steps finer than the floats around the center could not be told apart.
+    _format = format;
+    _center = format == FORMAT_HALF ? 0.0f : center;
+    _width = format == FORMAT_HALF ? 1.0f : std::max(width, fabsf(center) / 64.0f);
+    _storage = storage;
+    _apron = apron;
+    _table = decodeTable(format);
+
+    release();
+    if(storage == STORAGE_SPARSE)
+    {
+        // Rows span whole bricks, which pads them like VolumeGrid does.
+        _bricksX = (nx + 2 * apron + BRICK - 1) / BRICK;
+        _bricksY = (ny + 2 * apron + BRICK - 1) / BRICK;
+        _bricksZ = (nz + 2 * apron + BRICK - 1) / BRICK;
+        _rowStride = (size_t)_bricksZ * BRICK;
+        setBricks(std::vector<unsigned char>(), std::vector<float>());
+        return;
+    }
+
+    switch(format)
+    {
+    case FORMAT_FLOAT:
+        _floats.resize(nx, ny, nz, apron, center);
+        _rowStride = _floats.rowStride();
+        break;
+    case FORMAT_UNORM8:
+        _bytes.resize(nx, ny, nz, apron, encode(center));
+        _rowStride = _bytes.rowStride();
+        break;
+    default:
+        _shorts.resize(nx, ny, nz, apron, encode(center));
+        _rowStride = _shorts.rowStride();
+        break;
+    }
+}
+
+void SampleVolume::release()
+{
+    _floats.release();
+    _shorts.release();
+    _bytes.release();
+    _rowStride = 0;
+
+    std::vector<int32_t>().swap(_slots);
+    std::vector<float>().swap(_constants);
+    std::vector<float>().swap(_floatBricks);
+    std::vector<uint16_t>().swap(_shortBricks);
+    std::vector<uint8_t>().swap(_byteBricks);
+    _storedBricks = 0;
+}
+
+size_t SampleVolume::bytes() const
+{
+    return _floats.bytes() + _shorts.bytes() + _bytes.bytes()
+        + _slots.capacity() * sizeof(int32_t) + _constants.capacity() * sizeof(float)
+        + _floatBricks.capacity() * sizeof(float) + _shortBricks.capacity() * sizeof(uint16_t) + _byteBricks.capacity() * sizeof(uint8_t);
+}
+
+void SampleVolume::setBricks(const std::vector<unsigned char> &stored, const std::vector<float> &values)
+{
+    if(_storage != STORAGE_SPARSE)
+        return;
+
+    const size_t bricks = (size_t)_bricksX * _bricksY * _bricksZ;
+    _slots.assign(bricks, -1);
+    _constants.resize(bricks);
+    size_t count = 0;
+    for(size_t b = 0; b < bricks; b++)
+    {
+        // Kept as they read back from a stored brick.
+        const float value = values.empty() ? _center : values[b];
+        _constants[b] = _format == FORMAT_FLOAT ? value : decode(encode(value));
+        count += !stored.empty() && stored[b];
+    }
+
+    // Sized once, so the bricks can then be filled in place on any number of threads.
+    _storedBricks = 0;
+    std::vector<float>().swap(_floatBricks);
+    std::vector<uint16_t>().swap(_shortBricks);
+    std::vector<uint8_t>().swap(_byteBricks);
+    if(_format == FORMAT_FLOAT)
+        _floatBricks.reserve(count * BRICK_SAMPLES);
+    else if(_format == FORMAT_UNORM8)
+        _byteBricks.reserve(count * BRICK_SAMPLES);
+    else
+        _shortBricks.reserve(count * BRICK_SAMPLES);
+    for(size_t b = 0; b < bricks && count > 0; b++)
+        if(stored[b])
+            storeBrick(b);
+}
+
+size_t SampleVolume::storeBrick(const size_t brick)
+{
+    // Filled with the value the brick read as so far.
+    _slots[brick] = _storedBricks++;
+    if(_format == FORMAT_FLOAT)
+        _floatBricks.insert(_floatBricks.end(), BRICK_SAMPLES, _constants[brick]);
+    else if(_format == FORMAT_UNORM8)
+        _byteBricks.insert(_byteBricks.end(), BRICK_SAMPLES, (uint8_t)encode(_constants[brick]));
+    else
+        _shortBricks.insert(_shortBricks.end(), BRICK_SAMPLES, encode(_constants[brick]));
+    return _slots[brick];
+}
+
+uint16_t SampleVolume::encode(const float value) const
+{
+    if(_format == FORMAT_HALF)
+        return floatToHalf(value);
+
+    // The code whose range holds g, kept on the side of the center the value is on.
+    // In double, so a value read back lands in the middle of its code's range again.
+    const double half = _format == FORMAT_UNORM8 ? UNORM8_HALF : UNORM16_HALF;
+    const double d = (double)value - _center;
+    const double code = floor(d / (fabs(d) + _width) * half + half);
+    if(d > 0.0)
+        return (uint16_t)std::min(std::max(code, half), 2.0 * half - 1.0);
+    return (uint16_t)std::max(std::min(code, half - 1.0), 0.0);
+}
+
+void SampleVolume::set(const int x, const int y, const int z, const float value)
+{
+    if(_storage == STORAGE_SPARSE)
+    {
+        const unsigned i = x + _apron, j = y + _apron, k = z + _apron;
+        const size_t brick = ((size_t)(i / BRICK) * _bricksY + j / BRICK) * _bricksZ + k / BRICK;
+        const uint16_t code = _format == FORMAT_FLOAT ? 0 : encode(value);
+        if(_slots[brick] < 0 && (_format == FORMAT_FLOAT ? value : decode(code)) == _constants[brick])
+            return;
+        const size_t slot = _slots[brick] < 0 ? storeBrick(brick) : _slots[brick];
+        const size_t offset = slot * BRICK_SAMPLES + ((i % BRICK) * BRICK + j % BRICK) * BRICK + k % BRICK;
+        switch(_format)
+        {
+        case FORMAT_FLOAT:
+            _floatBricks[offset] = value;
+            break;
+        case FORMAT_UNORM8:
+            _byteBricks[offset] = (uint8_t)code;
+            break;
+        default:
+            _shortBricks[offset] = code;
+            break;
+        }
+        return;
+    }
+
+    switch(_format)
+    {
+    case FORMAT_FLOAT:
+        _floats(x, y, z) = value;
+        break;
+    case FORMAT_UNORM8:
+        _bytes(x, y, z) = (uint8_t)encode(value);
+        break;
+    default:
+        _shorts(x, y, z) = encode(value);
+        break;
+    }
+}
+
+void SampleVolume::endRow(const int x, const int y, const float *row)
+{
+    const float *values = row - _apron;
+    if(_storage == STORAGE_SPARSE)
+    {
+        // The part of the row in every stored brick.
+        const unsigned i = x + _apron, j = y + _apron;
+        const size_t brickRow = ((size_t)(i / BRICK) * _bricksY + j / BRICK) * _bricksZ;
+        const size_t inBrick = ((i % BRICK) * BRICK + j % BRICK) * BRICK;
+        for(unsigned bz = 0; bz < _bricksZ; bz++)
+        {
+            const int32_t slot = _slots[brickRow + bz];
+            if(slot < 0)
+                continue;
+            const size_t offset = (size_t)slot * BRICK_SAMPLES + inBrick;
+            const float *brickValues = values + bz * BRICK;
+            if(_format == FORMAT_FLOAT)
+                std::copy(brickValues, brickValues + BRICK, &_floatBricks[offset]);
+            else if(_format == FORMAT_UNORM8)
+                for(unsigned z = 0; z < BRICK; z++)
+                    _byteBricks[offset + z] = (uint8_t)encode(brickValues[z]);
+            else
+                for(unsigned z = 0; z < BRICK; z++)
+                    _shortBricks[offset + z] = encode(brickValues[z]);
+        }
+        return;
+    }
+
+    if(_format == FORMAT_FLOAT)
+        return;
+    if(_format == FORMAT_UNORM8)
+    {
+        uint8_t *codes = _bytes.row(x, y) - _apron;
+        for(size_t z = 0; z < _rowStride; z++)
+            codes[z] = (uint8_t)encode(values[z]);
+        return;
+    }
+    uint16_t *codes = _shorts.row(x, y) - _apron;
+    for(size_t z = 0; z < _rowStride; z++)
+        codes[z] = encode(values[z]);
+}
+
+const float *SampleVolume::decodeRow(const int x, const int y) const
+{
+    static thread_local std::vector<float> buffers;
+    static thread_local unsigned next = 0;
+    if(buffers.size() < ROW_BUFFERS * _rowStride)
+        buffers.resize(ROW_BUFFERS * _rowStride);
+    float *out = &buffers[(next++ % ROW_BUFFERS) * _rowStride];
+
+    if(_storage == STORAGE_SPARSE)
+    {
+        const unsigned i = x + _apron, j = y + _apron;
+        const size_t brickRow = ((size_t)(i / BRICK) * _bricksY + j / BRICK) * _bricksZ;
+        const size_t inBrick = ((i % BRICK) * BRICK + j % BRICK) * BRICK;
+        for(unsigned bz = 0; bz < _bricksZ; bz++)
+        {
+            float *brickOut = out + bz * BRICK;
+            const int32_t slot = _slots[brickRow + bz];
+            if(slot < 0)
+            {
+                std::fill(brickOut, brickOut + BRICK, _constants[brickRow + bz]);
+                continue;
+            }
+            const size_t offset = (size_t)slot * BRICK_SAMPLES + inBrick;
+            if(_format == FORMAT_FLOAT)
+                std::copy(&_floatBricks[offset], &_floatBricks[offset] + BRICK, brickOut);
+            else if(_format == FORMAT_UNORM8)
+                for(unsigned z = 0; z < BRICK; z++)
+                    brickOut[z] = decode(_byteBricks[offset + z]);
+            else
+                for(unsigned z = 0; z < BRICK; z++)
+                    brickOut[z] = decode(_shortBricks[offset + z]);
+        }
+    }
+    else if(_format == FORMAT_UNORM8)
+    {
+        const uint8_t *codes = _bytes.row(x, y) - _apron;
+        for(size_t z = 0; z < _rowStride; z++)
+            out[z] = decode(codes[z]);
+    }
+    else
+    {
+        const uint16_t *codes = _shorts.row(x, y) - _apron;
+        for(size_t z = 0; z < _rowStride; z++)
+            out[z] = decode(codes[z]);
+    }
+    return out + _apron;
+}
@@ -328,6 +328,99 @@ float snoise3(float x, float y, float z) {
     return 72.0f * (n0 + n1 + n2 + n3);
   }
 
+// Gradient vector that grad3() takes the dot product with, for the same hash.
+static void gradvec3( int hash, float *gx, float *gy, float *gz ) {
+    int h = hash & 15;
+    float su = (h&1)? -1.0f : 1.0f;
+    float sv = (h&2)? -1.0f : 1.0f;
+    *gx = *gy = *gz = 0.0f;
+    if(h<8) *gx = su; else *gy = su;
+    if(h<4) *gy = sv; else if(h==12||h==14) *gx = sv; else *gz = sv;
+}
+
+// 3D simplex noise with its analytic derivative.
+// Returns the same value as snoise3 and writes the gradient to (*dx, *dy, *dz).
+// Each corner contributes t^4 * (g.d) with t = 0.5 - |d|^2, which has the
+// derivative t^4 * g - 8 * t^3 * (g.d) * d.
+float sdnoise3(float x, float y, float z, float *dx, float *dy, float *dz) {
+
+    float n = 0.0f;
+    float gradx = 0.0f, grady = 0.0f, gradz = 0.0f;
+
+    // Skew the input space to determine which simplex cell we're in
+    float s = (x+y+z)*F3;
+    float xs = x+s;
+    float ys = y+s;
+    float zs = z+s;
+    int i = FASTFLOOR(xs);
+    int j = FASTFLOOR(ys);
+    int k = FASTFLOOR(zs);
+
+    float t = (float)(i+j+k)*G3;
+    float X0 = i-t; // Unskew the cell origin back to (x,y,z) space
+    float Y0 = j-t;
+    float Z0 = k-t;
+    float x0 = x-X0; // The x,y,z distances from the cell origin
+    float y0 = y-Y0;
+    float z0 = z-Z0;
+
+    // Same simplex traversal as snoise3
+    int i1, j1, k1;
+    int i2, j2, k2;
+    if(x0>=y0) {
+      if(y0>=z0)
+        { i1=1; j1=0; k1=0; i2=1; j2=1; k2=0; } // X Y Z order
+        else if(x0>=z0) { i1=1; j1=0; k1=0; i2=1; j2=0; k2=1; } // X Z Y order
+        else { i1=0; j1=0; k1=1; i2=1; j2=0; k2=1; } // Z X Y order
+      }
+    else { // x0<y0
+      if(y0<z0) { i1=0; j1=0; k1=1; i2=0; j2=1; k2=1; } // Z Y X order
+      else if(x0<z0) { i1=0; j1=1; k1=0; i2=0; j2=1; k2=1; } // Y Z X order
+      else { i1=0; j1=1; k1=0; i2=1; j2=1; k2=0; } // Y X Z order
+    }
+
+    // Offsets of the four corners, in the same order as snoise3
+    float cx[4], cy[4], cz[4];
+    int hash[4];
+    int ii = i & 0xff;
+    int jj = j & 0xff;
+    int kk = k & 0xff;
+
+    cx[0] = x0; cy[0] = y0; cz[0] = z0;
+    cx[1] = x0 - i1 + G3; cy[1] = y0 - j1 + G3; cz[1] = z0 - k1 + G3;
+    cx[2] = x0 - i2 + 2.0f*G3; cy[2] = y0 - j2 + 2.0f*G3; cz[2] = z0 - k2 + 2.0f*G3;
+    cx[3] = x0 - 1.0f + 3.0f*G3; cy[3] = y0 - 1.0f + 3.0f*G3; cz[3] = z0 - 1.0f + 3.0f*G3;
+
+    hash[0] = perm[ii+perm[jj+perm[kk]]];
+    hash[1] = perm[ii+i1+perm[jj+j1+perm[kk+k1]]];
+    hash[2] = perm[ii+i2+perm[jj+j2+perm[kk+k2]]];
+    hash[3] = perm[ii+1+perm[jj+1+perm[kk+1]]];
+
+    int c;
+    for(c = 0; c < 4; c++) {
+      float tc = 0.5f - cx[c]*cx[c] - cy[c]*cy[c] - cz[c]*cz[c];
+      if(tc < 0.0f) continue;
+
+      float gx, gy, gz;
+      gradvec3(hash[c], &gx, &gy, &gz);
+      float gdotd = grad3(hash[c], cx[c], cy[c], cz[c]);
+
+      float t2 = tc * tc;
+      float t4 = t2 * t2;
+      n += t4 * gdotd;
+
+      float t3dot = 8.0f * t2 * tc * gdotd;
+      gradx += t4 * gx - t3dot * cx[c];
+      grady += t4 * gy - t3dot * cy[c];
+      gradz += t4 * gz - t3dot * cz[c];
+    }
+
+    *dx = 72.0f * gradx;
+    *dy = 72.0f * grady;
+    *dz = 72.0f * gradz;
+    return 72.0f * n;
+  }
+
 
 // 4D simplex noise
 float snoise4(float x, float y, float z, float w) {
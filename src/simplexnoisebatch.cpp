@@ -0,0 +1,308 @@
+#include "simplexnoisebatch.h"
+#include "simplexnoise1234.h"
+
+#include <math.h>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define NOISE_X86
+#include <immintrin.h>
+#endif
+
+// The permutation table of simplexnoise1234.c, widened to ints for vector gathers.
+extern unsigned char perm[512];
+
+struct PermutationTable
+{
+    int table[512];
+
+    PermutationTable()
+    {
+        for (unsigned i = 0; i < 512; i++)
+            table[i] = perm[i];
+    }
+};
+
+static const int *permutation()
+{
+    static const PermutationTable p;
+    return p.table;
+}
+
+static const float F3 = 1.0f / 3.0f;
+static const float G3 = 1.0f / 6.0f;
+
+// Gradient dot product of snoise3's grad3, with float constants.
+static inline float grad3f(const int hash, const float x, const float y, const float z)
+{
+    const int h = hash & 15;
+    const float u = h < 8 ? x : y;
+    const float v = h < 4 ? y : (h == 12 || h == 14) ? x : z;
+    return ((h & 1) ? -u : u) + ((h & 2) ? -v : v);
+}
+
+// Contribution of one simplex corner.
+static inline float corner(const int hash, const float x, const float y, const float z)
+{
+    float t = 0.5f - x * x - y * y - z * z;
+    t = t < 0.0f ? 0.0f : t;
+    t *= t;
+    return t * t * grad3f(hash, x, y, z);
+}
+
+// snoise3 in single precision, the reference for the vector version.
+static inline float snoise3f(const float x, const float y, const float z, const int *p)
+{
+    const float s = (x + y + z) * F3;
+    const int i = (int)floorf(x + s);
+    const int j = (int)floorf(y + s);
+    const int k = (int)floorf(z + s);
+
+    const float t = (float)(i + j + k) * G3;
+    const float x0 = x - ((float)i - t);
+    const float y0 = y - ((float)j - t);
+    const float z0 = z - ((float)k - t);
+
+    // Offsets of the second and third corner, the same choice as snoise3 makes.
+    const bool xy = x0 >= y0, yz = y0 >= z0, xz = x0 >= z0;
+    const int i1 = xy && xz, j1 = !xy && yz, k1 = !xz && !yz;
+    const int i2 = xy || xz, j2 = !xy || yz, k2 = !xz || !yz;
+
+    const float x1 = x0 - (float)i1 + G3, y1 = y0 - (float)j1 + G3, z1 = z0 - (float)k1 + G3;
+    const float x2 = x0 - (float)i2 + 2.0f * G3, y2 = y0 - (float)j2 + 2.0f * G3, z2 = z0 - (float)k2 + 2.0f * G3;
+    const float x3 = x0 - 1.0f + 3.0f * G3, y3 = y0 - 1.0f + 3.0f * G3, z3 = z0 - 1.0f + 3.0f * G3;
+
+    const int ii = i & 0xff, jj = j & 0xff, kk = k & 0xff;
+
+    const float n0 = corner(p[ii + p[jj + p[kk]]], x0, y0, z0);
+    const float n1 = corner(p[ii + i1 + p[jj + j1 + p[kk + k1]]], x1, y1, z1);
+    const float n2 = corner(p[ii + i2 + p[jj + j2 + p[kk + k2]]], x2, y2, z2);
+    const float n3 = corner(p[ii + 1 + p[jj + 1 + p[kk + 1]]], x3, y3, z3);
+
+    return 72.0f * (n0 + n1 + n2 + n3);
+}
+
+void snoise3BatchScalar(const float *x, const float *y, const float *z, float *out, const unsigned count)
+{
+    const int *p = permutation();
+    for (unsigned n = 0; n < count; n++)
+        out[n] = snoise3f(x[n], y[n], z[n], p);
+}
+
+#ifdef NOISE_X86
+
+__attribute__((target("avx2")))
+static inline __m256 grad3AVX2(const __m256i hash, const __m256 x, const __m256 y, const __m256 z)
+{
+    const __m256i h = _mm256_and_si256(hash, _mm256_set1_epi32(15));
+
+    // u = h < 8 ? x : y, v = h < 4 ? y : (h == 12 || h == 14) ? x : z
+    const __m256 hLess8 = _mm256_castsi256_ps(_mm256_cmpgt_epi32(_mm256_set1_epi32(8), h));
+    const __m256 hLess4 = _mm256_castsi256_ps(_mm256_cmpgt_epi32(_mm256_set1_epi32(4), h));
+    const __m256 h12or14 = _mm256_castsi256_ps(_mm256_or_si256(
+        _mm256_cmpeq_epi32(h, _mm256_set1_epi32(12)), _mm256_cmpeq_epi32(h, _mm256_set1_epi32(14))));
+    const __m256 u = _mm256_blendv_ps(y, x, hLess8);
+    const __m256 v = _mm256_blendv_ps(_mm256_blendv_ps(z, x, h12or14), y, hLess4);
+
+    // Flip the signs with bits 0 and 1 of h, moved to the sign bit.
+    const __m256 uSign = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_and_si256(h, _mm256_set1_epi32(1)), 31));
+    const __m256 vSign = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_and_si256(h, _mm256_set1_epi32(2)), 30));
+    return _mm256_add_ps(_mm256_xor_ps(u, uSign), _mm256_xor_ps(v, vSign));
+}
+
+__attribute__((target("avx2")))
+static inline __m256 cornerAVX2(const __m256i hash, const __m256 x, const __m256 y, const __m256 z)
+{
+    __m256 t = _mm256_sub_ps(_mm256_sub_ps(_mm256_sub_ps(_mm256_set1_ps(0.5f), _mm256_mul_ps(x, x)),
+        _mm256_mul_ps(y, y)), _mm256_mul_ps(z, z));
+    t = _mm256_max_ps(t, _mm256_setzero_ps());
+    t = _mm256_mul_ps(t, t);
+    return _mm256_mul_ps(_mm256_mul_ps(t, t), grad3AVX2(hash, x, y, z));
+}
+
+__attribute__((target("avx2")))
+static inline __m256i hashAVX2(const int *p, const __m256i i, const __m256i j, const __m256i k)
+{
+    __m256i h = _mm256_i32gather_epi32(p, k, 4);
+    h = _mm256_i32gather_epi32(p, _mm256_add_epi32(j, h), 4);
+    return _mm256_i32gather_epi32(p, _mm256_add_epi32(i, h), 4);
+}
+
+__attribute__((target("avx2")))
+static inline __m256 snoise3AVX2(const __m256 x, const __m256 y, const __m256 z, const int *p)
+{
+    const __m256 s = _mm256_mul_ps(_mm256_add_ps(_mm256_add_ps(x, y), z), _mm256_set1_ps(F3));
+    const __m256i i = _mm256_cvtps_epi32(_mm256_floor_ps(_mm256_add_ps(x, s)));
+    const __m256i j = _mm256_cvtps_epi32(_mm256_floor_ps(_mm256_add_ps(y, s)));
+    const __m256i k = _mm256_cvtps_epi32(_mm256_floor_ps(_mm256_add_ps(z, s)));
+
+    const __m256 t = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_add_epi32(_mm256_add_epi32(i, j), k)), _mm256_set1_ps(G3));
+    const __m256 x0 = _mm256_sub_ps(x, _mm256_sub_ps(_mm256_cvtepi32_ps(i), t));
+    const __m256 y0 = _mm256_sub_ps(y, _mm256_sub_ps(_mm256_cvtepi32_ps(j), t));
+    const __m256 z0 = _mm256_sub_ps(z, _mm256_sub_ps(_mm256_cvtepi32_ps(k), t));
+
+    // Corner offsets as 0/1 integers from the comparison masks.
+    const __m256i xy = _mm256_castps_si256(_mm256_cmp_ps(x0, y0, _CMP_GE_OQ));
+    const __m256i yz = _mm256_castps_si256(_mm256_cmp_ps(y0, z0, _CMP_GE_OQ));
+    const __m256i xz = _mm256_castps_si256(_mm256_cmp_ps(x0, z0, _CMP_GE_OQ));
+    const __m256i one = _mm256_set1_epi32(1);
+    const __m256i i1 = _mm256_and_si256(_mm256_and_si256(xy, xz), one);
+    const __m256i j1 = _mm256_and_si256(_mm256_andnot_si256(xy, yz), one);
+    const __m256i k1 = _mm256_andnot_si256(_mm256_or_si256(xz, yz), one);
+    const __m256i i2 = _mm256_and_si256(_mm256_or_si256(xy, xz), one);
+    const __m256i j2 = _mm256_andnot_si256(_mm256_andnot_si256(yz, xy), one);
+    const __m256i k2 = _mm256_andnot_si256(_mm256_and_si256(xz, yz), one);
+
+    const __m256 g1 = _mm256_set1_ps(G3), g2 = _mm256_set1_ps(2.0f * G3), g3 = _mm256_set1_ps(3.0f * G3);
+    const __m256 x1 = _mm256_add_ps(_mm256_sub_ps(x0, _mm256_cvtepi32_ps(i1)), g1);
+    const __m256 y1 = _mm256_add_ps(_mm256_sub_ps(y0, _mm256_cvtepi32_ps(j1)), g1);
+    const __m256 z1 = _mm256_add_ps(_mm256_sub_ps(z0, _mm256_cvtepi32_ps(k1)), g1);
+    const __m256 x2 = _mm256_add_ps(_mm256_sub_ps(x0, _mm256_cvtepi32_ps(i2)), g2);
+    const __m256 y2 = _mm256_add_ps(_mm256_sub_ps(y0, _mm256_cvtepi32_ps(j2)), g2);
+    const __m256 z2 = _mm256_add_ps(_mm256_sub_ps(z0, _mm256_cvtepi32_ps(k2)), g2);
+    const __m256 oneF = _mm256_set1_ps(1.0f);
+    const __m256 x3 = _mm256_add_ps(_mm256_sub_ps(x0, oneF), g3);
+    const __m256 y3 = _mm256_add_ps(_mm256_sub_ps(y0, oneF), g3);
+    const __m256 z3 = _mm256_add_ps(_mm256_sub_ps(z0, oneF), g3);
+
+    const __m256i mask = _mm256_set1_epi32(0xff);
+    const __m256i ii = _mm256_and_si256(i, mask), jj = _mm256_and_si256(j, mask), kk = _mm256_and_si256(k, mask);
+
+    const __m256 n0 = cornerAVX2(hashAVX2(p, ii, jj, kk), x0, y0, z0);
+    const __m256 n1 = cornerAVX2(hashAVX2(p, _mm256_add_epi32(ii, i1), _mm256_add_epi32(jj, j1), _mm256_add_epi32(kk, k1)), x1, y1, z1);
+    const __m256 n2 = cornerAVX2(hashAVX2(p, _mm256_add_epi32(ii, i2), _mm256_add_epi32(jj, j2), _mm256_add_epi32(kk, k2)), x2, y2, z2);
+    const __m256 n3 = cornerAVX2(hashAVX2(p, _mm256_add_epi32(ii, one), _mm256_add_epi32(jj, one), _mm256_add_epi32(kk, one)), x3, y3, z3);
+
+    return _mm256_mul_ps(_mm256_set1_ps(72.0f), _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(n0, n1), n2), n3));
+}
+
+__attribute__((target("avx2")))
+void snoise3BatchAVX2(const float *x, const float *y, const float *z, float *out, const unsigned count)
+{
+    const int *p = permutation();
+    unsigned n = 0;
+    for (; n + 8 <= count; n += 8)
+        _mm256_storeu_ps(out + n, snoise3AVX2(_mm256_loadu_ps(x + n), _mm256_loadu_ps(y + n), _mm256_loadu_ps(z + n), p));
+    for (; n < count; n++)
+        out[n] = snoise3f(x[n], y[n], z[n], p);
+}
+
+__attribute__((target("avx2")))
+static void fbm3RowAVX2(const FbmOctaves &fbm, const unsigned first, const unsigned last,
+    const float x, const float y, const float *zs, float *out, const unsigned count)
+{
+    const int *p = permutation();
+
+    unsigned n = 0;
+    for (; n + 8 <= count; n += 8)
+    {
+        const __m256 z = _mm256_loadu_ps(zs + n);
+        __m256 sum = _mm256_loadu_ps(out + n);
+        for (unsigned o = first; o < last; o++)
+        {
+            const __m256 f = _mm256_set1_ps(fbm.frequency[o]);
+            const __m256 noise = snoise3AVX2(_mm256_set1_ps(x * fbm.frequency[o]), _mm256_set1_ps(y * fbm.frequency[o]), _mm256_mul_ps(z, f), p);
+            sum = _mm256_add_ps(sum, _mm256_mul_ps(noise, _mm256_set1_ps(fbm.amplitude[o])));
+        }
+        _mm256_storeu_ps(out + n, sum);
+    }
+
+    for (; n < count; n++)
+        for (unsigned o = first; o < last; o++)
+            out[n] += snoise3f(x * fbm.frequency[o], y * fbm.frequency[o], zs[n] * fbm.frequency[o], p) * fbm.amplitude[o];
+}
+
+static bool supportsAVX2()
+{
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+}
+
+#else
+
+void snoise3BatchAVX2(const float *x, const float *y, const float *z, float *out, const unsigned count)
+{
+    snoise3BatchScalar(x, y, z, out, count);
+}
+
+static bool supportsAVX2() { return false; }
+
+#endif
+
+static void fbm3RowScalar(const FbmOctaves &fbm, const unsigned first, const unsigned last,
+    const float x, const float y, const float *zs, float *out, const unsigned count)
+{
+    const int *p = permutation();
+    for (unsigned n = 0; n < count; n++)
+        for (unsigned o = first; o < last; o++)
+            out[n] += snoise3f(x * fbm.frequency[o], y * fbm.frequency[o], zs[n] * fbm.frequency[o], p) * fbm.amplitude[o];
+}
+
+void snoise3Batch(const float *x, const float *y, const float *z, float *out, const unsigned count)
+{
+    static const bool avx2 = supportsAVX2();
+    if (avx2)
+        snoise3BatchAVX2(x, y, z, out, count);
+    else
+        snoise3BatchScalar(x, y, z, out, count);
+}
+
+const char *snoiseBatchImplementation()
+{
+    return supportsAVX2() ? "avx2" : "scalar";
+}
+
+FbmOctaves::FbmOctaves(const unsigned octaves, const float baseFrequency, const float baseAmplitude,
+    const float lacunarity, const float gain)
+: octaves(octaves < FBM_MAX_OCTAVES ? octaves : FBM_MAX_OCTAVES)
+{
+    for (unsigned o = 0; o < this->octaves; o++)
+    {
+        frequency[o] = baseFrequency * powf(lacunarity, (float)o);
+        amplitude[o] = baseAmplitude * powf(gain, (float)o);
+    }
+
+    remaining[this->octaves] = 0.0f;
+    for (int o = (int)this->octaves - 1; o >= 0; o--)
+        remaining[o] = remaining[o + 1] + amplitude[o];
+}
+
+void fbm3RowOctaves(const FbmOctaves &fbm, const unsigned first, const unsigned last,
+    const float x, const float y, const float *z, float *out, const unsigned count)
+{
+    const unsigned end = last < fbm.octaves ? last : fbm.octaves;
+#ifdef NOISE_X86
+    static const bool avx2 = supportsAVX2();
+    if (avx2)
+    {
+        fbm3RowAVX2(fbm, first, end, x, y, z, out, count);
+        return;
+    }
+#endif
+    fbm3RowScalar(fbm, first, end, x, y, z, out, count);
+}
+
+void fbm3Row(const FbmOctaves &fbm, const float x, const float y, const float *z,
+    float *out, const unsigned count)
+{
+    fbm3RowOctaves(fbm, 0, fbm.octaves, x, y, z, out, count);
+}
+
+float fbm3Gradient(const FbmOctaves &fbm, const float x, const float y, const float z,
+    float *dx, float *dy, float *dz)
+{
+    float value = 0.0f;
+    *dx = *dy = *dz = 0.0f;
+    for (unsigned o = 0; o < fbm.octaves; o++)
+    {
+        // d/dp a * noise(f * p) = a * f * noise'(f * p)
+        float gx, gy, gz;
+        const float f = fbm.frequency[o];
+        value += sdnoise3(x * f, y * f, z * f, &gx, &gy, &gz) * fbm.amplitude[o];
+
+        const float scale = fbm.amplitude[o] * f;
+        *dx += gx * scale;
+        *dy += gy * scale;
+        *dz += gz * scale;
+    }
+    return value;
+}
@@ -0,0 +1,348 @@
+#include "terrainarena.h"
+#include "profiler.h"
+
+#include <algorithm>
+
+RangeAllocator::RangeAllocator(const unsigned capacity)
+: _capacity(0), _used(0)
+{
+    grow(capacity);
+}
+
+bool RangeAllocator::allocate(const unsigned size, unsigned &offset)
+{
+    if(size == 0)
+    {
+        offset = 0;
+        return true;
+    }
+
+    for(std::map<unsigned, unsigned>::iterator range = _free.begin(); range != _free.end(); ++range)
+    {
+        if(range->second < size)
+            continue;
+
+        // Take the front of the range and keep the rest free.
+        offset = range->first;
+        const unsigned rest = range->second - size;
+        _free.erase(range);
+        if(rest > 0)
+            _free[offset + size] = rest;
+        _used += size;
+        return true;
+    }
+    return false;
+}
+
+void RangeAllocator::release(const unsigned offset, const unsigned size)
+{
+    if(size == 0)
+        return;
+    _used -= size;
+
+    unsigned start = offset;
+    unsigned end = offset + size;
+    std::map<unsigned, unsigned>::iterator next = _free.lower_bound(offset);
+
+    // Merge with the free ranges before and after, if they touch.
+    if(next != _free.begin())
+    {
+        std::map<unsigned, unsigned>::iterator previous = next;
+        --previous;
+        if(previous->first + previous->second == offset)
+        {
+            start = previous->first;
+            _free.erase(previous);
+        }
+    }
+    if(next != _free.end() && next->first == end)
+    {
+        end += next->second;
+        _free.erase(next);
+    }
+
+    _free[start] = end - start;
+}
+
+void RangeAllocator::grow(const unsigned capacity)
+{
+    if(capacity <= _capacity)
+        return;
+    const unsigned oldCapacity = _capacity;
+    _capacity = capacity;
+    _used += capacity - oldCapacity;
+    release(oldCapacity, capacity - oldCapacity);
+}
+
+// Immutable storage that glBufferSubData can still write to, or a plain buffer
+// where immutable storage is missing.
+static void allocateStorage(const GLenum target, const size_t bytes)
+{
+    if(GLEW_ARB_buffer_storage)
+        glBufferStorage(target, bytes, NULL, GL_DYNAMIC_STORAGE_BIT);
+    else
+        glBufferData(target, bytes, NULL, GL_STATIC_DRAW);
+}
+
+TerrainArena::TerrainArena(const unsigned vertexCapacity, const unsigned triangleCapacity, const VertexFormat::Layout layout, const float quantum)
+: _layout(layout), _vertexBytes(VertexFormat::vertexBytes(layout)), _quantum(quantum), _originsChanged(false),
+  _VAO(0), _VBO(0), _EBO(0), _indirectBuffer(0), _originBuffer(0)
+{
+    glGenBuffers(1, &_indirectBuffer);
+    glGenBuffers(1, &_originBuffer);
+    resize(std::max(vertexCapacity, 1u), std::max(3 * triangleCapacity, 1u));
+    resetFrameStats();
+}
+
+TerrainArena::~TerrainArena()
+{
+    glDeleteVertexArrays(1, &_VAO);
+    glDeleteBuffers(1, &_VBO);
+    glDeleteBuffers(1, &_EBO);
+    glDeleteBuffers(1, &_indirectBuffer);
+    glDeleteBuffers(1, &_originBuffer);
+}
+
+void TerrainArena::resize(const unsigned vertexCapacity, const unsigned indexCapacity)
+{
+    PROFILE_SCOPE("arena grow");
+    GLuint VBO, EBO;
+    glGenBuffers(1, &VBO);
+    glGenBuffers(1, &EBO);
+
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    allocateStorage(GL_ARRAY_BUFFER, _vertexBytes * vertexCapacity);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    glBindBuffer(GL_COPY_WRITE_BUFFER, EBO);
+    allocateStorage(GL_COPY_WRITE_BUFFER, sizeof(GLuint) * indexCapacity);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    // Move the cells over on the GPU, their offsets stay the same.
+    if(_VAO)
+    {
+        glBindBuffer(GL_COPY_READ_BUFFER, _VBO);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, VBO);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, _vertexBytes * _vertexRanges.capacity());
+
+        glBindBuffer(GL_COPY_READ_BUFFER, _EBO);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, EBO);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, sizeof(GLuint) * _indexRanges.capacity());
+
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+        glDeleteVertexArrays(1, &_VAO);
+        glDeleteBuffers(1, &_VBO);
+        glDeleteBuffers(1, &_EBO);
+    }
+
+    _VBO = VBO;
+    _EBO = EBO;
+    _vertexRanges.grow(vertexCapacity);
+    _indexRanges.grow(indexCapacity);
+
+    glGenVertexArrays(1, &_VAO);
+    glBindVertexArray(_VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, _VBO);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _EBO);
+
+    if(_layout == VertexFormat::LAYOUT_FLOAT)
+    {
+        // Same vertex layout as the VoxelData buffers.
+        //Vertex position attribute
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, _vertexBytes, (GLvoid*)0);
+        glEnableVertexAttribArray(0);
+        //Vertex normal attribute
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, _vertexBytes, (GLvoid*)(sizeof(glm::vec3)));
+        glEnableVertexAttribArray(1);
+    }
+    else
+    {
+        // Positions as steps of the cell's quantum, converted to float unnormalized.
+        // Normals as normalized octahedral coordinates.
+        const bool compact = _layout == VertexFormat::LAYOUT_COMPACT;
+        glVertexAttribPointer(0, 3, GL_UNSIGNED_SHORT, GL_FALSE, _vertexBytes, (GLvoid*)0);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(1, 2, compact ? GL_BYTE : GL_SHORT, GL_TRUE, _vertexBytes,
+            (GLvoid*)(compact ? offsetof(VertexFormat::CompactVertex, normal) : offsetof(VertexFormat::PackedVertex, normal)));
+        glEnableVertexAttribArray(1);
+
+        // Origin and quantum of the cell, one per draw command.
+        glBindBuffer(GL_ARRAY_BUFFER, _originBuffer);
+        glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, sizeof(glm::vec4), (GLvoid*)0);
+        glVertexAttribDivisor(3, 1);
+        glEnableVertexAttribArray(3);
+    }
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+unsigned TerrainArena::addCell(const std::vector<glm::vec3> &vertexData, const std::vector<glm::ivec3> &indices)
+{
+    return addCell(vertexData.data(), vertexData.size(), indices.data(), indices.size());
+}
+
+unsigned TerrainArena::addCell(const glm::vec3 *vertexData, const size_t vertexDataSize, const glm::ivec3 *indices, const size_t numberOfIndices)
+{
+    PROFILE_SCOPE("arena upload");
+    Cell cell;
+    cell.numberOfVertices = vertexDataSize / 2;
+    cell.numberOfIndices = 3 * numberOfIndices;
+    cell.firstVertex = cell.firstIndex = 0;
+    cell.used = cell.visible = true;
+
+    // Grow the buffers to at least twice their size until both ranges fit.
+    bool fits = _vertexRanges.allocate(cell.numberOfVertices, cell.firstVertex);
+    if(fits && !_indexRanges.allocate(cell.numberOfIndices, cell.firstIndex))
+    {
+        _vertexRanges.release(cell.firstVertex, cell.numberOfVertices);
+        fits = false;
+    }
+    if(!fits)
+    {
+        resize(std::max(2 * _vertexRanges.capacity(), _vertexRanges.capacity() + cell.numberOfVertices),
+            std::max(2 * _indexRanges.capacity(), _indexRanges.capacity() + cell.numberOfIndices));
+        _vertexRanges.allocate(cell.numberOfVertices, cell.firstVertex);
+        _indexRanges.allocate(cell.numberOfIndices, cell.firstIndex);
+    }
+
+    glm::vec4 origin(0.0f, 0.0f, 0.0f, 1.0f);
+    if(cell.numberOfVertices > 0)
+    {
+        const void *vertices = vertexData;
+        if(_layout != VertexFormat::LAYOUT_FLOAT)
+        {
+            origin = VertexFormat::pack(_layout, vertexData, cell.numberOfVertices, _quantum, _packed);
+            vertices = _packed.data();
+        }
+        glBindBuffer(GL_ARRAY_BUFFER, _VBO);
+        glBufferSubData(GL_ARRAY_BUFFER, _vertexBytes * cell.firstVertex, _vertexBytes * cell.numberOfVertices, vertices);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+    if(cell.numberOfIndices > 0)
+    {
+        // The element buffer binding belongs to the VAO, so write through another target.
+        glBindBuffer(GL_COPY_WRITE_BUFFER, _EBO);
+        glBufferSubData(GL_COPY_WRITE_BUFFER, sizeof(GLuint) * cell.firstIndex, sizeof(glm::ivec3) * numberOfIndices, indices);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    }
+    _stats.bytesUploaded += _vertexBytes * cell.numberOfVertices + sizeof(GLuint) * cell.numberOfIndices;
+
+    unsigned id = _cells.size();
+    if(!_freeCells.empty())
+    {
+        id = _freeCells.back();
+        _freeCells.pop_back();
+        _cells[id] = cell;
+        _origins[id] = origin;
+    }
+    else
+    {
+        _cells.push_back(cell);
+        _origins.push_back(origin);
+    }
+    _originsChanged = true;
+    return id;
+}
+
+void TerrainArena::removeCell(const unsigned cell)
+{
+    if(cell >= _cells.size() || !_cells[cell].used)
+        return;
+
+    _vertexRanges.release(_cells[cell].firstVertex, _cells[cell].numberOfVertices);
+    _indexRanges.release(_cells[cell].firstIndex, _cells[cell].numberOfIndices);
+    _cells[cell].used = false;
+    _freeCells.push_back(cell);
+}
+
+void TerrainArena::setVisible(const unsigned cell, const bool visible)
+{
+    if(cell < _cells.size())
+        _cells[cell].visible = visible;
+}
+
+void TerrainArena::draw()
+{
+    PROFILE_SCOPE("arena draw");
+    // One command per visible cell, its indices are offset by its first vertex.
+    _commands.clear();
+    for(unsigned i = 0; i < _cells.size(); i++)
+    {
+        const Cell &cell = _cells[i];
+        if(!cell.used || !cell.visible || cell.numberOfIndices == 0)
+            continue;
+
+        DrawCommand command;
+        command.count = cell.numberOfIndices;
+        command.instanceCount = 1;
+        command.firstIndex = cell.firstIndex;
+        command.baseVertex = cell.firstVertex;
+        command.baseInstance = i;
+        _commands.push_back(command);
+        _stats.trianglesDrawn += cell.numberOfIndices / 3;
+    }
+
+    if(_commands.empty())
+        return;
+
+    glEnable(GL_CULL_FACE);
+
+    GLint program = 0;
+    GLint packedLoc = -1;
+    if(_layout != VertexFormat::LAYOUT_FLOAT)
+    {
+        if(_originsChanged)
+        {
+            glBindBuffer(GL_ARRAY_BUFFER, _originBuffer);
+            glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec4) * _origins.size(), _origins.data(), GL_DYNAMIC_DRAW);
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+            _stats.bytesUploaded += sizeof(glm::vec4) * _origins.size();
+            _originsChanged = false;
+        }
+        glGetIntegerv(GL_CURRENT_PROGRAM, &program);
+        packedLoc = glGetUniformLocation(program, "packedVertices");
+        glUniform1i(packedLoc, 1);
+    }
+    glBindVertexArray(_VAO);
+
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, _indirectBuffer);
+    glBufferData(GL_DRAW_INDIRECT_BUFFER, sizeof(DrawCommand) * _commands.size(), _commands.data(), GL_STREAM_DRAW);
+    glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, 0, _commands.size(), 0);
+
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    glBindVertexArray(0);
+
+    // Other meshes drawn with the program have float vertices.
+    if(packedLoc >= 0)
+        glUniform1i(packedLoc, 0);
+
+    _stats.drawCalls++;
+    _stats.cellsDrawn += _commands.size();
+    _stats.bytesUploaded += sizeof(DrawCommand) * _commands.size();
+}
+
+void TerrainArena::resetFrameStats()
+{
+    _stats.drawCalls = 0;
+    _stats.cellsDrawn = 0;
+    _stats.trianglesDrawn = 0;
+    _stats.bytesUploaded = 0;
+}
+
+size_t TerrainArena::capacityBytes() const
+{
+    return _vertexBytes * _vertexRanges.capacity() + sizeof(GLuint) * _indexRanges.capacity();
+}
+
+size_t TerrainArena::usedBytes() const
+{
+    return _vertexBytes * _vertexRanges.used() + sizeof(GLuint) * _indexRanges.used();
+}
+
+size_t TerrainArena::cellBytes(const size_t vertexDataSize, const size_t numberOfIndices) const
+{
+    return _vertexBytes * (vertexDataSize / 2) + sizeof(GLuint) * 3 * numberOfIndices;
+}
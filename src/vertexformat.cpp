@@ -0,0 +1,200 @@
+#include "vertexformat.h"
+#include "profiler.h"
+
+#include <cmath>
+#include <cfloat>
+#include <cstring>
+#include <algorithm>
+
+size_t VertexFormat::vertexBytes(const Layout layout)
+{
+    switch(layout)
+    {
+    case LAYOUT_PACKED:
+        return sizeof(PackedVertex);
+    case LAYOUT_COMPACT:
+        return sizeof(CompactVertex);
+    default:
+        return 2 * sizeof(glm::vec3);
+    }
+}
+
+const char *VertexFormat::name(const Layout layout)
+{
+    switch(layout)
+    {
+    case LAYOUT_PACKED:
+        return "packed";
+    case LAYOUT_COMPACT:
+        return "compact";
+    default:
+        return "float";
+    }
+}
+
+float VertexFormat::quantum(const float extent)
+{
+    float q = ldexpf(1.0f, -24);
+    while(extent / q > 65533.0f)
+        q *= 2.0f;
+    return q;
+}
+
+glm::vec2 VertexFormat::encodeOctahedral(const glm::vec3 &normal)
+{
+    const float sum = fabsf(normal.x) + fabsf(normal.y) + fabsf(normal.z);
+    if(sum == 0.0f)
+        return glm::vec2(0.0f, 0.0f);
+    const float x = normal.x / sum, y = normal.y / sum;
+
+    // The lower half is folded over the diagonals onto the corners. Written with
+    // selects instead of branches, normals flip sides too often to predict.
+    const bool lower = normal.z < 0.0f;
+    return glm::vec2(lower ? copysignf(1.0f - fabsf(y), x) : x, lower ? copysignf(1.0f - fabsf(x), y) : y);
+}
+
+// The octahedron point of the coordinates, a normal before it is normalized. Moving
+// x and y towards zero by the depth below the square unfolds the corners, the same
+// as the decode in phong.vert.
+static glm::vec3 unfold(const float x, const float y)
+{
+    const float z = 1.0f - fabsf(x) - fabsf(y);
+    const float t = std::max(-z, 0.0f);
+    return glm::vec3(x >= 0.0f ? x - t : x + t, y >= 0.0f ? y - t : y + t, z);
+}
+
+glm::vec3 VertexFormat::decodeOctahedral(const glm::vec2 &coordinates)
+{
+    return glm::normalize(unfold(coordinates.x, coordinates.y));
+}
+
+// Normalized signed value the GL reads from a code of the given scale (127 or 32767).
+static float unpackSigned(const float code, const float scale)
+{
+    return std::max(code / scale, -1.0f);
+}
+
+// Rounds the octahedral coordinates of normal to the code of the given scale that
+// decodes closest to it, plain rounding is off by up to twice as much.
+template<typename T>
+static void packNormal(const glm::vec3 &normal, const float scale, T *code)
+{
+    // Rounded down through a non-negative value, truncating is cheaper than floorf.
+    const glm::vec2 coordinates = VertexFormat::encodeOctahedral(normal);
+    const float x = (float)(int)(coordinates.x * scale + scale) - scale, y = (float)(int)(coordinates.y * scale + scale) - scale;
+    const float inverse = 1.0f / scale;
+    float cx = x, cy = y, best = -FLT_MAX;
+    for(unsigned i = 0; i < 4; i++)
+    {
+        const float tx = std::min(x + (i & 1), scale), ty = std::min(y + (i >> 1), scale);
+        const glm::vec3 decoded = unfold(std::max(tx * inverse, -1.0f), std::max(ty * inverse, -1.0f));
+        const float cosine = (decoded.x * normal.x + decoded.y * normal.y + decoded.z * normal.z)
+            / sqrtf(decoded.x * decoded.x + decoded.y * decoded.y + decoded.z * decoded.z);
+        const bool better = cosine > best;
+        best = better ? cosine : best;
+        cx = better ? tx : cx;
+        cy = better ? ty : cy;
+    }
+    code[0] = (T)cx;
+    code[1] = (T)cy;
+}
+
+glm::vec4 VertexFormat::pack(const Layout layout, const glm::vec3 *vertexData, const size_t numberOfVertices, const float quantum,
+    std::vector<unsigned char> &out)
+{
+    PROFILE_SCOPE("pack vertices");
+    out.resize(vertexBytes(layout) * numberOfVertices);
+    if(layout == LAYOUT_FLOAT)
+    {
+        if(numberOfVertices > 0)
+            memcpy(out.data(), vertexData, out.size());
+        return glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+    }
+
+    glm::vec3 low(0.0f), high(0.0f);
+    if(numberOfVertices > 0)
+        low = high = vertexData[0];
+    for(size_t v = 1; v < numberOfVertices; v++)
+    {
+        low = glm::min(low, vertexData[2 * v]);
+        high = glm::max(high, vertexData[2 * v]);
+    }
+
+    // The origin is the box rounded down to the lattice. The quantum grows until the
+    // box fits in 16 bits and every decoded position stays exact in a float.
+    double q = quantum > 0.0f ? quantum : VertexFormat::quantum(std::max(high.x - low.x, std::max(high.y - low.y, high.z - low.z)));
+    double first[3];
+    for(bool fits = false; !fits; )
+    {
+        fits = true;
+        for(unsigned i = 0; i < 3; i++)
+        {
+            first[i] = floor(low[i] / q);
+            fits = fits && ceil(high[i] / q) - first[i] <= 65535.0 && fabs(first[i]) + 65535.0 < 16777216.0;
+        }
+        if(!fits)
+            q *= 2.0;
+    }
+
+    // Positions are rounded on the lattice itself, so a vertex shared with a cell
+    // packed with the same quantum gets the same position back. Scaling by a power
+    // of two and moving by whole steps are exact, and the steps from the origin are
+    // never negative, so truncating rounds them.
+    const double steps = 1.0 / q;
+    for(size_t v = 0; v < numberOfVertices; v++)
+    {
+        const glm::vec3 &position = vertexData[2 * v];
+        uint16_t code[3];
+        for(unsigned i = 0; i < 3; i++)
+            code[i] = (uint16_t)(position[i] * steps - first[i] + 0.5);
+
+        if(layout == LAYOUT_PACKED)
+        {
+            PackedVertex &vertex = ((PackedVertex *)out.data())[v];
+            vertex.position[0] = code[0];
+            vertex.position[1] = code[1];
+            vertex.position[2] = code[2];
+            vertex.position[3] = 0;
+            packNormal(vertexData[2 * v + 1], 32767.0f, vertex.normal);
+        }
+        else
+        {
+            CompactVertex &vertex = ((CompactVertex *)out.data())[v];
+            memcpy(vertex.position, code, sizeof(code));
+            packNormal(vertexData[2 * v + 1], 127.0f, vertex.normal);
+        }
+    }
+    return glm::vec4((float)(first[0] * q), (float)(first[1] * q), (float)(first[2] * q), (float)q);
+}
+
+void VertexFormat::unpack(const Layout layout, const unsigned char *packed, const size_t numberOfVertices, const glm::vec4 &origin,
+    std::vector<glm::vec3> &vertexData)
+{
+    vertexData.resize(2 * numberOfVertices);
+    if(layout == LAYOUT_FLOAT)
+    {
+        if(numberOfVertices > 0)
+            memcpy(vertexData.data(), packed, vertexBytes(layout) * numberOfVertices);
+        return;
+    }
+
+    for(size_t v = 0; v < numberOfVertices; v++)
+    {
+        const uint16_t *position;
+        glm::vec2 normal;
+        if(layout == LAYOUT_PACKED)
+        {
+            const PackedVertex &vertex = ((const PackedVertex *)packed)[v];
+            position = vertex.position;
+            normal = glm::vec2(unpackSigned(vertex.normal[0], 32767.0f), unpackSigned(vertex.normal[1], 32767.0f));
+        }
+        else
+        {
+            const CompactVertex &vertex = ((const CompactVertex *)packed)[v];
+            position = vertex.position;
+            normal = glm::vec2(unpackSigned(vertex.normal[0], 127.0f), unpackSigned(vertex.normal[1], 127.0f));
+        }
+        vertexData[2 * v] = glm::vec3(origin.x + origin.w * position[0], origin.y + origin.w * position[1], origin.z + origin.w * position[2]);
+        vertexData[2 * v + 1] = decodeOctahedral(normal);
+    }
+}
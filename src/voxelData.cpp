@@ -1,4 +1,7 @@
 #include "voxelData.h"
+#include "profiler.h"
+
+#include <float.h>
 
 // Function for printing glm::vec3 for debugging.
 std::ostream& operator<<(std::ostream& os, const glm::vec3 &v)
@@ -7,87 +10,332 @@ std::ostream& operator<<(std::ostream& os, const glm::vec3 &v)
     return os;
 } 
 
-VoxelData::VoxelData(const unsigned dim, const float gridSize, const glm::vec3 gridCenter)
-: _dim(dim), _gridSize(gridSize), _gridCenter(gridCenter), _table(LookupTable())
+// Lower corner (relative to the cube) and axis (0 = x, 1 = y, 2 = z) of each of
+// the twelve cube edges. Neighbouring cubes map a shared edge to the same grid edge.
+static const int edgeOrigin[12][4] = {
+    {0, 0, 0, 1}, {0, 1, 0, 0}, {1, 0, 0, 1}, {0, 0, 0, 0},
+    {0, 0, 1, 1}, {0, 1, 1, 0}, {1, 0, 1, 1}, {0, 0, 1, 0},
+    {0, 0, 0, 2}, {0, 1, 0, 2}, {1, 1, 0, 2}, {1, 0, 0, 2}
+};
+
+// Bounds on snoise3 that bounded and truncated generation rely on: its range and how
+// fast it can change. Each of the four corners of the simplex around a point adds
+// 72 t^4 (g.d), with d the offset to the corner, t = 0.5 - |d|^2 > 0 and |g| = sqrt(2),
+// which is at most 72 sqrt(2) |d| t^4 = 0.9365 (at |d|^2 = 1/18). Its gradient
+// 72 (t^4 g - 8 t^3 (g.d) d) is at most 72 sqrt(2) (t^4 + 8 t^3 |d|^2) = 8.016 long
+// (at |d|^2 = 1/14). The bounds are four times that, rounded up. ROUNDING_MARGIN covers
+// the rounding of the single precision batched noise against the scalar snoise3 and
+// of the bounds themselves.
+static const float NOISE_RANGE = 3.75f;
+static const float NOISE_SLOPE = 32.1f;
+static const float ROUNDING_MARGIN = 1e-3f;
+
+// Bounded generation decides for bricks of samples at a time. The apron around a
+// brick must stay clear of the surface too, since normals read the samples next to
+// the ends of the edges that cross it. Sparse volumes store the same bricks.
+static const unsigned GENERATION_BRICK = SampleVolume::BRICK;
+static const unsigned GENERATION_APRON = 2;
+
+// Samples that truncated generation stops adding octaves to together.
+static const unsigned TRUNCATION_CHUNK = 16;
+
+// Distance from the isovalue, in field units, at which the steps of the unorm sample
+// formats have doubled. The same for every dim, so neighbouring cells of any level of
+// detail store a shared sample the same way.
+static const float SAMPLE_WIDTH = 1.0f / 64.0f;
+
+// Octaves of the terrain noise and the amplitude of the first one.
+static const unsigned TERRAIN_OCTAVES = 8;
+static const float TERRAIN_AMPLITUDE = 0.25f;
+
+// The noise scale of the octaves until generateData sets them.
+static const float DEFAULT_NOISE_SCALE = 0.1f;
+
+FbmOctaves VoxelData::terrainOctaves(const float noiseScale)
 {
-    omp_init_lock(&writelock);
-    omp_init_lock(&writelockIndices);
+    return FbmOctaves(TERRAIN_OCTAVES, noiseScale, TERRAIN_AMPLITUDE);
+}
 
+VoxelData::VoxelData(const unsigned dim, const float gridSize, const glm::vec3 gridCenter)
+: _dim(dim), _gridSize(gridSize), _gridCenter(gridCenter), _seamless(false), _cell(0), _fbm(terrainOctaves(DEFAULT_NOISE_SCALE)), _table(LookupTable())
+{
     //std::cout << "Allocating memory... ";
-    // Resize data-holder to the given dimensions and initiate it with 0's.
-    _data.resize(dim + 1);
-    for(unsigned i = 0; i < dim + 1; i++)
-    {
-        _data[i].resize(dim + 1);
-        for(unsigned j = 0; j < dim + 1; j++)
-        {
-            _data[i][j].resize(dim + 1, 0.0);
-        }
-    }
+    // Allocate one contiguous block for the (dim + 1)^3 samples and initiate it with 0's.
+    _data.resize(dim + 1, dim + 1, dim + 1, 0);
     //std::cout << "done!" << std::endl;
+}
 
-    _boundingBoxVertices.push_back(glm::vec3(-gridSize/2.0, -gridSize/2.0, -gridSize/2.0) - gridCenter);
-    _boundingBoxVertices.push_back(glm::vec3(-gridSize/2.0, -gridSize/2.0, gridSize/2.0) - gridCenter);
-    _boundingBoxVertices.push_back(glm::vec3(-gridSize/2.0, gridSize/2.0, -gridSize/2.0) - gridCenter);
-    _boundingBoxVertices.push_back(glm::vec3(-gridSize/2.0, gridSize/2.0, gridSize/2.0) - gridCenter);
-    _boundingBoxVertices.push_back(glm::vec3(gridSize/2.0, -gridSize/2.0, -gridSize/2.0) - gridCenter);
-    _boundingBoxVertices.push_back(glm::vec3(gridSize/2.0, -gridSize/2.0, gridSize/2.0) - gridCenter);
-    _boundingBoxVertices.push_back(glm::vec3(gridSize/2.0, gridSize/2.0, -gridSize/2.0) - gridCenter);
-    _boundingBoxVertices.push_back(glm::vec3(gridSize/2.0, gridSize/2.0, gridSize/2.0) - gridCenter);
-    
-    _boundingBoxIndices.push_back(0);
-    _boundingBoxIndices.push_back(1);
-    _boundingBoxIndices.push_back(5);
-    _boundingBoxIndices.push_back(7);
-    _boundingBoxIndices.push_back(3);
-    _boundingBoxIndices.push_back(2);
-    _boundingBoxIndices.push_back(6);
-    _boundingBoxIndices.push_back(4);
-    _boundingBoxIndices.push_back(0);
-    _boundingBoxIndices.push_back(4);
-    _boundingBoxIndices.push_back(5);
-    _boundingBoxIndices.push_back(1);
-    _boundingBoxIndices.push_back(3);
-    _boundingBoxIndices.push_back(7);
-    _boundingBoxIndices.push_back(6);
-    _boundingBoxIndices.push_back(2);
-    _boundingBoxIndices.push_back(0);
+VoxelData::VoxelData(const unsigned dim, const float gridSize, const glm::ivec3 &cell)
+: _dim(dim), _gridSize(gridSize), _gridCenter(-gridSize * (glm::vec3)cell), _seamless(true), _cell(cell), _fbm(terrainOctaves(DEFAULT_NOISE_SCALE)), _table(LookupTable())
+{
+    // The samples and an apron of one sample on every side, for the normals.
+    _data.resize(dim + 1, dim + 1, dim + 1, 1);
+}
 
-    
+void VoxelData::setSampleFormat(const SampleVolume::Format format, const float isovalue, const SampleVolume::Storage storage)
+{
+    _data.resize(_dim + 1, _dim + 1, _dim + 1, _data.apron(), format, isovalue, SAMPLE_WIDTH, storage);
+    _bricks.clear();
+    _hasData = false;
 }
 
 void VoxelData::generateData(const float noiseScale)
 {
+    PROFILE_SCOPE("generateData");
     //float startTime = glfwGetTime();    
-    
-    #pragma omp parallel for
-    // Fill voxels with test-data, distance to center of volume.    
-    for(unsigned x = 0; x < _dim + 1; x++)
+
+    // Kept so analytic normals can evaluate the same field.
+    _fbm = terrainOctaves(noiseScale);
+
+    // Samples along each axis, the apron included. Index i holds sample i - apron.
+    const int apron = _data.apron();
+    const unsigned n = _dim + 1 + 2 * apron;
+
+    // Every z-row samples the same z world coordinates. The last run of noise in a row
+    // carries on into the row's padding, so it is all done in whole vectors.
+    const unsigned rowEnd = _data.rowStride();
+    std::vector<float> rowZ(rowEnd);
+    for(unsigned z = 0; z < rowEnd; z++)
+        rowZ[z] = getWorldPosition(0, 0, (int)z - apron).z;
+
+    // The bricks of samples that need the noise, and the constant the others get.
+    const unsigned bricks = (n + GENERATION_BRICK - 1) / GENERATION_BRICK;
+    std::vector<unsigned char> brickNoise((size_t)bricks * bricks * bricks, 1);
+    std::vector<float> brickValue;
+    if(_generationMode != GENERATE_FULL)
+        boundBricks(bricks, brickNoise, brickValue);
+    _data.setBricks(brickNoise, brickValue);
+
+    // Planes handed over by neighbours are copied in afterwards. The x-planes are whole
+    // rows that are skipped, the z-planes are only a few samples of each row, which the
+    // vectors cover at no extra cost, so they are evaluated all the same.
+    const unsigned xBegin = _borderSlabs[FACE_LOW_X].empty() ? 0 : BORDER_PLANES;
+    const unsigned xEnd = n - (_borderSlabs[FACE_HIGH_X].empty() ? 0 : BORDER_PLANES);
+
+    size_t octaveSamples = 0;
+    #pragma omp parallel reduction(+:octaveSamples)
     {
-        for(unsigned y = 0; y < _dim + 1; y++)
+        // Rows the volume does not keep as floats in place are filled in here first.
+        std::vector<float> scratch(rowEnd);
+
+        #pragma omp for
+        // Fill voxels with a plane at y = 0 displaced by noise, one z-row at a time.
+        for(unsigned i = xBegin; i < xEnd; i++)
         {
-            for(unsigned z = 0; z < _dim + 1; z++)
+            const int x = (int)i - apron;
+            for(unsigned j = 0; j < n; j++)
             {
-                //Create a plane at y = 0.
-                _data[x][y][z] = (float)(y) / (float)(_dim + 1);
+                const int y = (int)j - apron;
+                float *row = _data.beginRow(x, y, scratch.data()) - apron;
+                const glm::vec3 pos = getWorldPosition(x, y, 0);
+                const size_t brickRow = ((size_t)(i / GENERATION_BRICK) * bricks + j / GENERATION_BRICK) * bricks;
 
+                //Create a plane at y = 0.
+                std::fill(row, row + rowEnd, planeValue(y));
 
-                for(int octave = 0; octave < 8; octave++)
+                // Runs of bricks that need the noise get it, the others their constant.
+                for(unsigned first = 0; first < bricks;)
                 {
-                    glm::vec3 pos = getWorldPosition(x,y,z) * noiseScale * (float)pow(2, octave);
-                    float noise = snoise3(pos.x, pos.y, pos.z) * 0.25 * (1.0 / (pow(2, octave)));
+                    const unsigned z0 = first * GENERATION_BRICK;
+                    if(!brickNoise[brickRow + first])
+                    {
+                        std::fill(row + z0, row + std::min(z0 + GENERATION_BRICK, n), brickValue[brickRow + first]);
+                        first++;
+                        continue;
+                    }
 
-                    _data[x][y][z] += noise;
+                    unsigned last = first;
+                    while(last < bricks && brickNoise[brickRow + last])
+                        last++;
+                    const unsigned z1 = last == bricks ? rowEnd : last * GENERATION_BRICK;
+                    octaveSamples += addNoise(pos.x, pos.y, &rowZ[z0], row + z0, z1 - z0);
+                    first = last;
                 }
+                _data.endRow(x, y, row + apron);
             }
+
+            /*if(omp_get_thread_num() == 0)
+                std::cout << "Generating data " << (int)(((float)(x+1) * (float)omp_get_num_threads() / (float)_dim) * 100) << "%"
+                << " on " << omp_get_num_threads() << " threads. Running time: " << glfwGetTime() - startTime << " seconds." << std::flush << "       \r";
+            */
         }
-        
-        /*if(omp_get_thread_num() == 0)
-            std::cout << "Generating data " << (int)(((float)(x+1) * (float)omp_get_num_threads() / (float)_dim) * 100) << "%"
-            << " on " << omp_get_num_threads() << " threads. Running time: " << glfwGetTime() - startTime << " seconds." << std::flush << "       \r";        
-        */
     }
     //std::cout << std::endl;
+
+    for(unsigned face = 0; face < 4; face++)
+        if(!_borderSlabs[face].empty())
+        {
+            copyBorderSlab((Face)face);
+            std::vector<float>().swap(_borderSlabs[face]);
+        }
+
+    _noiseWork = octaveSamples / ((double)n * n * rowEnd * _fbm.octaves);
+    _hasData = true;
+    PROFILE_COUNTER("cell noise work", _noiseWork);
+
+    _bricks.build(_data, _dim);
+}
+
+void VoxelData::boundBricks(const unsigned bricks, std::vector<unsigned char> &noise, std::vector<float> &value) const
+{
+    const int apron = _data.apron();
+    value.assign((size_t)bricks * bricks * bricks, 0.0f);
+
+    #pragma omp parallel for schedule(dynamic)
+    for(int bx = 0; bx < (int)bricks; bx++)
+        for(unsigned by = 0; by < bricks; by++)
+            for(unsigned bz = 0; bz < bricks; bz++)
+            {
+                // The samples of the brick and the apron around it. It is not clipped to the
+                // volume, so a constant handed to a neighbour holds for its samples as well.
+                const glm::ivec3 low = glm::ivec3(bx, by, bz) * (int)GENERATION_BRICK - apron - (int)GENERATION_APRON;
+                const glm::ivec3 high = low + (int)(GENERATION_BRICK - 1 + 2 * GENERATION_APRON);
+                const glm::vec3 lowPos = getWorldPosition(low.x, low.y, low.z);
+                const glm::vec3 highPos = getWorldPosition(high.x, high.y, high.z);
+                const glm::vec3 center = 0.5f * (lowPos + highPos);
+                const float radius = glm::length(0.5f * (highPos - lowPos));
+
+                // Bricks at a border bent to a coarser neighbour keep the exact samples the
+                // neighbour's cubes have.
+                bool border = false;
+                for(unsigned face = 0; face < 4; face++)
+                {
+                    const int axis = face < FACE_LOW_Z ? 0 : 2;
+                    const int plane = (face & 1) ? (int)_dim : 0;
+                    border = border || (_coarseRatio[face] > 1 && low[axis] <= plane && high[axis] >= plane);
+                }
+                for(unsigned corner = 0; corner < 4; corner++)
+                {
+                    const int x = (corner & 2) ? (int)_dim : 0, z = (corner & 1) ? (int)_dim : 0;
+                    border = border || (_cornerRatio[corner >> 1][corner & 1] > 1 && low.x <= x && high.x >= x && low.z <= z && high.z >= z);
+                }
+                if(border)
+                    continue;
+
+                // The plane, plus every octave's value at the center and how far it can
+                // change within the radius, at most its whole range.
+                float minValue = planeValue(low.y);
+                float maxValue = planeValue(high.y);
+                for(unsigned o = 0; o < _fbm.octaves; o++)
+                {
+                    const float f = _fbm.frequency[o];
+                    const float a = _fbm.amplitude[o];
+                    const float spread = NOISE_SLOPE * f * radius;
+                    if(spread >= 2.0f * NOISE_RANGE)
+                    {
+                        minValue -= a * NOISE_RANGE;
+                        maxValue += a * NOISE_RANGE;
+                        continue;
+                    }
+                    const float v = snoise3(center.x * f, center.y * f, center.z * f);
+                    minValue += a * std::max(v - spread, -NOISE_RANGE);
+                    maxValue += a * std::min(v + spread, NOISE_RANGE);
+                }
+                minValue -= ROUNDING_MARGIN;
+                maxValue += ROUNDING_MARGIN;
+
+                // Inside is above the isovalue, outside at or below it.
+                const size_t i = ((size_t)bx * bricks + by) * bricks + bz;
+                if(minValue > _generationIsovalue)
+                {
+                    noise[i] = 0;
+                    value[i] = minValue;
+                }
+                else if(maxValue < _generationIsovalue)
+                {
+                    noise[i] = 0;
+                    value[i] = maxValue;
+                }
+            }
+}
+
+unsigned VoxelData::addNoise(const float x, const float y, const float *z, float *out, const unsigned count) const
+{
+    if(_generationMode != GENERATE_TRUNCATED)
+    {
+        fbm3Row(_fbm, x, y, z, out, count);
+        return count * _fbm.octaves;
+    }
+
+    // Add the octaves to a few samples at a time. A sample stops taking them once the
+    // remaining ones cannot bring it across the isovalue, which depends on the sample
+    // alone, so cells that share it agree on its value.
+    unsigned octaveSamples = 0;
+    float octave[TRUNCATION_CHUNK];
+    bool decided[TRUNCATION_CHUNK];
+    for(unsigned first = 0; first < count; first += TRUNCATION_CHUNK)
+    {
+        const unsigned size = std::min(TRUNCATION_CHUNK, count - first);
+        std::fill(decided, decided + size, false);
+        for(unsigned o = 0; o < _fbm.octaves; o++)
+        {
+            std::fill(octave, octave + size, 0.0f);
+            fbm3RowOctaves(_fbm, o, o + 1, x, y, z + first, octave, size);
+            octaveSamples += size;
+
+            const float reach = _fbm.remaining[o + 1] * NOISE_RANGE + ROUNDING_MARGIN;
+            bool allDecided = true;
+            for(unsigned i = 0; i < size; i++)
+            {
+                if(decided[i])
+                    continue;
+                out[first + i] += octave[i];
+                decided[i] = fabsf(out[first + i] - _generationIsovalue) > reach;
+                allDecided = allDecided && decided[i];
+            }
+            if(allDecided)
+                break;
+        }
+    }
+    return octaveSamples;
+}
+
+glm::ivec3 VoxelData::borderSample(const Face face, const int p, const int u, const int v) const
+{
+    // Planes from low to high along the face's axis, each ordered by the other two
+    // axes in x, y, z order, from -1 to dim + 1.
+    const int plane = (face == FACE_HIGH_X || face == FACE_HIGH_Z) ? (int)_dim - 1 + p : p - 1;
+    if(face == FACE_LOW_X || face == FACE_HIGH_X)
+        return glm::ivec3(plane, u - 1, v - 1);
+    return glm::ivec3(u - 1, v - 1, plane);
+}
+
+bool VoxelData::getBorderSlab(const Face face, std::vector<float> &slab) const
+{
+    if(!_seamless || conforming() || !_hasData)
+        return false;
+
+    const unsigned n = _dim + 3;
+    slab.resize(BORDER_PLANES * n * n);
+    for(unsigned p = 0; p < BORDER_PLANES; p++)
+        for(unsigned u = 0; u < n; u++)
+            for(unsigned v = 0; v < n; v++)
+            {
+                const glm::ivec3 s = borderSample(face, p, u, v);
+                slab[(p * n + u) * n + v] = _data(s.x, s.y, s.z);
+            }
+    return true;
+}
+
+bool VoxelData::setBorderSlab(const Face face, const std::vector<float> &slab)
+{
+    if(!_seamless || slab.size() != BORDER_PLANES * (_dim + 3) * (_dim + 3))
+        return false;
+    _borderSlabs[face] = slab;
+    return true;
+}
+
+void VoxelData::copyBorderSlab(const Face face)
+{
+    const unsigned n = _dim + 3;
+    const std::vector<float> &slab = _borderSlabs[face];
+    for(unsigned p = 0; p < BORDER_PLANES; p++)
+        for(unsigned u = 0; u < n; u++)
+            for(unsigned v = 0; v < n; v++)
+            {
+                const glm::ivec3 s = borderSample(face, p, u, v);
+                _data.set(s.x, s.y, s.z, slab[(p * n + u) * n + v]);
+            }
 }
 
 void VoxelData::getInfo(bool showdata, bool printvertices, bool printnormals) const
@@ -100,52 +348,272 @@ void VoxelData::getInfo(bool showdata, bool printvertices, bool printnormals) co
             {
                 for(unsigned z = 0; z < _dim + 1; z++)
                 {
-                    std::cout << _data[x][y][z] << ", ";
+                    std::cout << _data(x, y, z) << ", ";
                 }
                 std::cout << std::endl;
             }
             std::cout << std::endl;
         }
     
+    // Vertices and normals are read from the interleaved array, which both mesh
+    // strategies fill.
     if(printvertices)
-        for(unsigned i = 0; i < _vertices.size(); i++)
-            std::cout << "Vertice " << i << ": " << _vertices[i] << std::endl;
+        for(unsigned i = 0; i < _VBOarray.size() / 2; i++)
+            std::cout << "Vertice " << i << ": " << _VBOarray[2 * i] << std::endl;
 
     if(printnormals)
-        for(unsigned i = 0; i < _normals.size(); i++)
-            std::cout << "Normal " << i << ": " << _normals[i] << std::endl;
+        for(unsigned i = 0; i < _VBOarray.size() / 2; i++)
+            std::cout << "Normal " << i << ": " << _VBOarray[2 * i + 1] << std::endl;
 
-    std::cout << "Vertices: " << _vertices.size() << std::endl;
-    std::cout << "Normals: " << _normals.size() << std::endl;
-    std::cout << "Indices: " << _indices.size() << std::endl;
+    std::cout << "Vertices: " << getNumberOfVertices() << std::endl;
+    std::cout << "Normals: " << getNumberOfVertices() << std::endl;
+    std::cout << "Indices: " << getNumberOfTriangles() << std::endl;
+    std::cout << "Peak meshing memory: " << _peakMeshingBytes / (1024.0 * 1024.0) << " MB (volume "
+    << _data.bytes() / (1024.0 * 1024.0) << " MB)" << std::endl;
 }
 
 void VoxelData::generateTriangles(const float isovalue)
 {
+    PROFILE_SCOPE("generateTriangles");
     _isovalue = isovalue;
-    //float startTime = glfwGetTime();
+    _vertices.clear();
+    _normals.clear();
+    _indices.clear();
+    _VBOarray.clear();
+    _peakMeshingBytes = 0;
+    _numberOfActiveCubes = 0;
+
+    // Bend the borders to coarser neighbours for this isovalue. The ranges of the
+    // bricks change with them.
+    if(conforming())
+    {
+        conformBorders();
+        _bricks.clear();
+    }
+
+    // Find the bricks the surface can pass through, the rest of the volume is skipped.
+    if(_bricks.empty())
+        _bricks.build(_data, _dim);
+    _numberOfActiveBricks = _bricks.findActive(_isovalue, _activeBricks);
+    PROFILE_COUNTER("cell skipped bricks", getNumberOfSkippedBricks());
+
+    _meshTimings = MeshTimings();
+
+    double start = omp_get_wtime();
+    if(_normalMode == NORMALS_CENTRAL)
+        computeGradients();
+    _meshTimings.gradients = omp_get_wtime() - start;
+
+    start = omp_get_wtime();
+    if(_meshStrategy == MESH_TWO_PASS)
+    {
+        generateTrianglesTwoPass();
+        _meshTimings.mesh = omp_get_wtime() - start;
+    }
+    else
+    {
+        generateTrianglesInBlocks();
+        _meshTimings.mesh = omp_get_wtime() - start;
+
+        start = omp_get_wtime();
+        createVBO();
+        _meshTimings.packing = omp_get_wtime() - start;
+        notePeakMeshingBytes(meshingBytes());
+    }
+
+    // The gradients are only needed while the vertices are created.
+    std::vector<float>().swap(_gradients);
+    std::vector<int>().swap(_gradientRows);
+
+    if(conforming())
+        dropCollapsedTriangles();
+
+    _numberOfTriangles = _indices.size();
+    _numberOfVertices = _VBOarray.size() / 2;
+    PROFILE_COUNTER("cell triangles", _numberOfTriangles);
+    PROFILE_COUNTER("cell active cubes", _numberOfActiveCubes);
+}
+
+void VoxelData::computeGradients()
+{
+    PROFILE_SCOPE("computeGradients");
+    const unsigned n = _dim + 1;
+    const size_t stride = _data.rowStride();
+
+    // Find the rows of cubes the surface passes through.
+    std::vector<unsigned char> activeRow(_dim * _dim);
+    #pragma omp parallel
+    {
+        std::vector<unsigned char> cases(_dim);
+        std::vector<unsigned> active(_dim);
+
+        #pragma omp for
+        for(int x = 0; x < (int)_dim; x++)
+            for(unsigned y = 0; y < _dim; y++)
+                activeRow[x * _dim + y] = classifyRow(x, y, &cases[0], &active[0]) > 0;
+    }
+
+    // Vertices only lie on edges of active cubes, so only the grid rows at their
+    // corners get a slot in the gradient array.
+    _gradientRows.assign(n * n, -1);
+    std::vector<unsigned> rows;
+    for(unsigned x = 0; x < n; x++)
+        for(unsigned y = 0; y < n; y++)
+        {
+            bool needed = false;
+            for(unsigned cx = std::max(x, 1u) - 1; cx <= std::min(x, _dim - 1); cx++)
+                for(unsigned cy = std::max(y, 1u) - 1; cy <= std::min(y, _dim - 1); cy++)
+                    needed = needed || activeRow[cx * _dim + cy];
+            if(!needed)
+                continue;
+            _gradientRows[x * n + y] = rows.size();
+            rows.push_back(x * n + y);
+        }
+
+    // Each slot holds the x, y and z components of a row one after the other.
+    _gradients.resize(3 * stride * rows.size());
+
+    #pragma omp parallel for schedule(dynamic, 16)
+    for(int r = 0; r < (int)rows.size(); r++)
+    {
+        const unsigned x = rows[r] / n;
+        const unsigned y = rows[r] % n;
+
+        // Central differences inside the volume and the apron, one-sided ones on the faces
+        // of a volume without an apron.
+        const int apron = _data.apron();
+        const int x0 = std::max((int)x - 1, -apron), x1 = std::min((int)(x + 1), (int)_dim + apron);
+        const int y0 = std::max((int)y - 1, -apron), y1 = std::min((int)(y + 1), (int)_dim + apron);
+        const float *left = _data.row(x0, y);
+        const float *right = _data.row(x1, y);
+        const float *below = _data.row(x, y0);
+        const float *above = _data.row(x, y1);
+        const float *row = _data.row(x, y);
+        const float sx = 1.0f / (float)(x1 - x0);
+        const float sy = 1.0f / (float)(y1 - y0);
+
+        float *gx = &_gradients[3 * stride * r];
+        float *gy = gx + stride;
+        float *gz = gy + stride;
+
+        #pragma omp simd
+        for(unsigned z = 0; z < n; z++)
+        {
+            gx[z] = (right[z] - left[z]) * sx;
+            gy[z] = (above[z] - below[z]) * sy;
+        }
+
+        #pragma omp simd
+        for(unsigned z = 1; z < _dim; z++)
+            gz[z] = (row[z + 1] - row[z - 1]) * 0.5f;
+        if(apron)
+        {
+            gz[0] = (row[1] - row[-1]) * 0.5f;
+            gz[_dim] = (row[_dim + 1] - row[_dim - 1]) * 0.5f;
+        }
+        else
+        {
+            gz[0] = row[1] - row[0];
+            gz[_dim] = row[_dim] - row[_dim - 1];
+        }
+    }
+}
+
+const glm::vec3 VoxelData::gradientAt(const glm::ivec3 &pos) const
+{
+    const size_t stride = _data.rowStride();
+    const float *g = &_gradients[3 * stride * _gradientRows[pos.x * (_dim + 1) + pos.y]] + pos.z;
+    return glm::vec3(g[0], g[stride], g[2 * stride]);
+}
+
+unsigned VoxelData::classifyRow(const unsigned x, const unsigned y, unsigned char *cases, unsigned *active) const
+{
+    // The four z-rows that hold the corners of this row of cubes, fetched at the first
+    // active brick since rows of samples not stored as floats are decoded.
+    const float *r00 = NULL, *r01 = NULL, *r11 = NULL, *r10 = NULL;
+
+    // Only runs of bricks that straddle the isovalue are classified, the cubes of the
+    // others are all inside or all outside. cases is left unset for skipped cubes.
+    const unsigned bricks = _bricks.bricksPerAxis();
+    const unsigned char *brickRow = &_activeBricks[((x / BrickPyramid::BRICK) * bricks + y / BrickPyramid::BRICK) * bricks];
+    unsigned count = 0;
+    for(unsigned first = 0; first < bricks;)
+    {
+        if(!brickRow[first])
+        {
+            first++;
+            continue;
+        }
+        unsigned last = first;
+        while(last < bricks && brickRow[last])
+            last++;
+        if(!r00)
+        {
+            r00 = _data.row(x, y);
+            r01 = _data.row(x, y + 1);
+            r11 = _data.row(x + 1, y + 1);
+            r10 = _data.row(x + 1, y);
+        }
+
+        const unsigned z0 = first * BrickPyramid::BRICK;
+        const unsigned z1 = std::min(last * BrickPyramid::BRICK, _dim);
+        const unsigned found = classifyCubes(r00 + z0, r01 + z0, r11 + z0, r10 + z0, z1 - z0, _isovalue, cases + z0, active + count);
+        for(unsigned a = count; a < count + found; a++)
+            active[a] += z0;
+        count += found;
+        first = last;
+    }
+    return count;
+}
+
+void VoxelData::generateTrianglesInBlocks()
+{
+    // Split the volume into blocks of slabs. Every block is meshed into its own
+    // arrays by whichever thread takes it, and the blocks are then copied into the
+    // final arrays in block order, so the mesh is the same for any number of threads.
+    const unsigned numberOfBlocks = (_dim + SLABS_PER_BLOCK - 1) / SLABS_PER_BLOCK;
+    std::vector<MeshBlock> blocks(numberOfBlocks);
+
+    #pragma omp parallel
+    {
+        EdgeCache cache;
+        if(_meshMode == MESH_INDEXED)
+            cache.resize(_dim + 1);
+
+        PROFILE_SCOPE("meshBlocks");
+        #pragma omp for schedule(dynamic)
+        for(int b = 0; b < (int)numberOfBlocks; b++)
+        {
+            if(_meshMode == MESH_INDEXED)
+                generateBlockIndexed(b, blocks[b], cache);
+            else
+                generateBlockUnindexed(b, blocks[b]);
+        }
+    }
+
+    mergeBlocks(blocks);
+}
+
+void VoxelData::generateBlockUnindexed(const unsigned block, MeshBlock &out)
+{
+    const unsigned lastX = std::min(_dim, (block + 1) * SLABS_PER_BLOCK);
+    std::vector<unsigned char> cases(_dim);
+    std::vector<unsigned> active(_dim);
 
-    #pragma omp parallel for        
     // Create triangles from the voxel data and the current isovalue.
-    // Loop over all cubes in the volume.
-    for (unsigned x = 0; x < _dim; x++)
+    // Loop over all cubes in the block.
+    for (unsigned x = block * SLABS_PER_BLOCK; x < lastX; x++)
     {
         for (unsigned y = 0; y < _dim; y++)
         {
-            for (unsigned z = 0; z < _dim; z++)
-            {
-                unsigned triangleConfiguration = 0;
-
-                // Compare the datapoints in one cube to the threshold.
-                if (_data[x][y][z] > isovalue) triangleConfiguration |= 1;
-                if (_data[x][y+1][z] > isovalue) triangleConfiguration |= 2;
-                if (_data[x+1][y+1][z] > isovalue) triangleConfiguration |= 4;
-                if (_data[x+1][y][z] > isovalue) triangleConfiguration |= 8;
+            const unsigned activeCubes = classifyRow(x, y, &cases[0], &active[0]);
+            out.activeCubes += activeCubes;
 
-                if (_data[x][y][z+1] > isovalue) triangleConfiguration |= 16;
-                if (_data[x][y+1][z+1] > isovalue) triangleConfiguration |= 32;
-                if (_data[x+1][y+1][z+1] > isovalue) triangleConfiguration |= 64;
-                if (_data[x+1][y][z+1] > isovalue) triangleConfiguration |= 128;
+            // Only cubes that the surface passes through have triangles.
+            for (unsigned a = 0; a < activeCubes; a++)
+            {
+                const unsigned z = active[a];
+                const unsigned triangleConfiguration = cases[z];
 
                 // Add vertices at the necessary edges, at the correct positions.
                 for(unsigned n = 0; n < 16 && _table.triangleTable[triangleConfiguration][n] != -1; n += 3)
@@ -153,94 +621,510 @@ void VoxelData::generateTriangles(const float isovalue)
                     unsigned e1 = _table.triangleTable[triangleConfiguration][n];
                     unsigned e2 = _table.triangleTable[triangleConfiguration][n+1];
                     unsigned e3 = _table.triangleTable[triangleConfiguration][n+2];
-                    createTriangle(e1, e2, e3, x, y, z);
+                    createTriangle(e1, e2, e3, x, y, z, out);
                 }
 
             }
         }
-        /*if(omp_get_thread_num() == 0)        
-            std::cout << "Generating triangles " << (int)(((float)(x+1) * (float)omp_get_num_threads() / (float)_dim) * 100) << "%"
-            << " on " << omp_get_num_threads() << " threads. Running time: " << glfwGetTime() - startTime << " seconds." << std::flush << "       \r";
-        */
     }
-    //std::cout << std::endl;    
-            
-    createVBO();
-    createBuffers();
 }
 
-void VoxelData::createTriangle(unsigned e1, unsigned e2, unsigned e3, const unsigned x, const unsigned y, const unsigned z)
+void VoxelData::generateBlockIndexed(const unsigned block, MeshBlock &out, EdgeCache &cache)
 {
+    // Number of grid points along each axis.
+    const unsigned n = _dim + 1;
+    const unsigned firstX = block * SLABS_PER_BLOCK;
+    const unsigned lastX = std::min(_dim, firstX + SLABS_PER_BLOCK);
+    std::vector<unsigned char> cases(_dim);
+    std::vector<unsigned> active(_dim);
 
-    unsigned edges[] = {e1, e2, e3};
+    std::fill(cache.lowPlane.begin(), cache.lowPlane.end(), -1);
 
-    std::vector<glm::vec3> tempVert;
-    std::vector<glm::vec3> tempNormal;
+    for (unsigned x = firstX; x < lastX; x++)
+    {
+        std::fill(cache.highPlane.begin(), cache.highPlane.end(), -1);
+        std::fill(cache.slabEdges.begin(), cache.slabEdges.end(), -1);
 
-    // Loop through the three edges.
-    for(unsigned i = 0; i < 3; i++)
+        // The upper plane of the last slab belongs to the next block, which creates
+        // its vertices. Triangles here refer to them by -(2 + plane index) until merged.
+        const bool sharedHighPlane = (x + 1 == lastX && lastX < _dim);
+
+        for (unsigned y = 0; y < _dim; y++)
+        {
+            const unsigned activeCubes = classifyRow(x, y, &cases[0], &active[0]);
+            out.activeCubes += activeCubes;
+
+            for (unsigned a = 0; a < activeCubes; a++)
+            {
+                const unsigned z = active[a];
+                const int *triangles = _table.triangleTable[cases[z]];
+                for(unsigned t = 0; t < 16 && triangles[t] != -1; t += 3)
+                {
+                    int ids[3];
+                    for(unsigned i = 0; i < 3; i++)
+                    {
+                        const int *edge = edgeOrigin[triangles[t + i]];
+                        const unsigned ey = y + edge[1];
+                        const unsigned ez = z + edge[2];
+                        const unsigned planeIndex = 2 * (ey * n + ez) + edge[3] - 1;
+
+                        if(edge[0] && edge[3] != 0 && sharedHighPlane)
+                        {
+                            ids[i] = -2 - (int)planeIndex;
+                            continue;
+                        }
+
+                        // Look the edge up in the cache, create its vertex on first use.
+                        int &id = edge[3] == 0 ? cache.slabEdges[ey * n + ez]
+                            : (edge[0] ? cache.highPlane : cache.lowPlane)[planeIndex];
+                        if(id == -1)
+                        {
+                            glm::ivec3 pos1(x + edge[0], ey, ez);
+                            glm::ivec3 pos2 = pos1;
+                            pos2[edge[3]]++;
+
+                            glm::vec3 vertex, normal;
+                            createVertex(pos1, pos2, vertex, normal);
+
+                            id = out.vertices.size();
+                            out.vertices.push_back(vertex);
+                            out.normals.push_back(normal);
+                        }
+                        ids[i] = id;
+                    }
+                    out.indices.push_back(glm::ivec3(ids[0], ids[1], ids[2]));
+                }
+            }
+        }
+
+        // Keep the ids of the first plane so the previous block can resolve its references.
+        if(x == firstX && block > 0)
+            out.firstPlane = cache.lowPlane;
+
+        // The upper plane of this slab is the lower plane of the next one.
+        cache.lowPlane.swap(cache.highPlane);
+    }
+}
+
+void VoxelData::mergeBlocks(std::vector<MeshBlock> &blocks)
+{
+    PROFILE_SCOPE("mergeBlocks");
+    // Exclusive prefix sums give every block its offset in the final arrays.
+    std::vector<unsigned> vertexOffset(blocks.size() + 1, 0);
+    std::vector<unsigned> indexOffset(blocks.size() + 1, 0);
+    size_t blockBytes = 0;
+    for(unsigned b = 0; b < blocks.size(); b++)
+    {
+        vertexOffset[b + 1] = vertexOffset[b] + blocks[b].vertices.size();
+        _numberOfActiveCubes += blocks[b].activeCubes;
+        indexOffset[b + 1] = indexOffset[b] + blocks[b].indices.size();
+        blockBytes += (blocks[b].vertices.capacity() + blocks[b].normals.capacity()) * sizeof(glm::vec3)
+            + blocks[b].indices.capacity() * sizeof(glm::ivec3) + blocks[b].firstPlane.capacity() * sizeof(int);
+    }
+
+    _vertices.resize(vertexOffset[blocks.size()]);
+    _normals.resize(vertexOffset[blocks.size()]);
+    _indices.resize(indexOffset[blocks.size()]);
+    notePeakMeshingBytes(blockBytes + meshingBytes());
+
+    #pragma omp parallel for schedule(dynamic)
+    for(int b = 0; b < (int)blocks.size(); b++)
     {
-        unsigned v1, v2;
+        const MeshBlock &block = blocks[b];
+        std::copy(block.vertices.begin(), block.vertices.end(), _vertices.begin() + vertexOffset[b]);
+        std::copy(block.normals.begin(), block.normals.end(), _normals.begin() + vertexOffset[b]);
 
-        // Determine which vertices v1 & v2 in a cube are connected to the current edge.
-        if(edges[i] < 8)
+        for(unsigned i = 0; i < block.indices.size(); i++)
         {
-            v1 = edges[i];
-            v2 = ((edges[i]+1) % 4) + ((edges[i] / 4) * 4);
+            glm::ivec3 triangle = block.indices[i];
+            for(unsigned k = 0; k < 3; k++)
+            {
+                if(triangle[k] >= 0)
+                    triangle[k] += vertexOffset[b];
+                else
+                    triangle[k] = blocks[b + 1].firstPlane[-2 - triangle[k]] + vertexOffset[b + 1];
+            }
+            _indices[indexOffset[b] + i] = triangle;
         }
-        else
+    }
+
+    blocks.clear();
+}
+
+void VoxelData::generateTrianglesTwoPass()
+{
+    // Number of grid points along each axis.
+    const unsigned n = _dim + 1;
+    const bool indexed = (_meshMode == MESH_INDEXED);
+
+    // First pass: count the triangles of every slab of cubes and, for the indexed
+    // mesh, the vertices owned by every layer of the grid (the intersected y- and
+    // z-edges in plane x and the x-edges leaving it).
+    std::vector<unsigned> triangleOffset(n, 0);
+    std::vector<unsigned> vertexOffset(n + 1, 0);
+    unsigned activeTotal = 0;
+
+    #pragma omp parallel
+    {
+        PROFILE_SCOPE("countPass");
+        std::vector<unsigned char> cases(_dim);
+        std::vector<unsigned> active(_dim);
+
+        #pragma omp for schedule(dynamic) reduction(+:activeTotal)
+        for (int x = 0; x < (int)n; x++)
         {
-            v1 = edges[i] - 4;
-            v2 = edges[i] - 8;
+            if(indexed)
+                vertexOffset[x + 1] = numberLayer(x, 0, NULL, NULL, false);
+
+            if(x == (int)_dim)
+                continue;
+
+            unsigned triangles = 0;
+            for (unsigned y = 0; y < _dim; y++)
+            {
+                const unsigned activeCubes = classifyRow(x, y, &cases[0], &active[0]);
+                activeTotal += activeCubes;
+                for (unsigned a = 0; a < activeCubes; a++)
+                    triangles += _table.triangleCount[cases[active[a]]];
+            }
+            triangleOffset[x + 1] = triangles;
         }
-        
-        // Get the world position for the two vertices (not yet between 0 and 1).
-        glm::ivec3 pos1 = getPosition(v1, x, y, z);
-        glm::ivec3 pos2 = getPosition(v2, x, y, z);
+    }
+
+    _numberOfActiveCubes = activeTotal;
+
+    // Exclusive prefix sums turn the counts into each slab's and layer's first element.
+    for (unsigned x = 0; x < _dim; x++)
+        triangleOffset[x + 1] += triangleOffset[x];
+    for (unsigned x = 0; x < n; x++)
+        vertexOffset[x + 1] += vertexOffset[x];
+
+    const unsigned numberOfTriangles = triangleOffset[_dim];
+    const unsigned numberOfVertices = indexed ? vertexOffset[n] : 3 * numberOfTriangles;
+
+    // The mesh is written straight into its final, exactly sized arrays.
+    _indices.resize(numberOfTriangles);
+    _VBOarray.resize(2 * numberOfVertices);
+
+    const int threads = omp_get_max_threads();
+    const size_t scratchBytes = threads * ((indexed ? 5 * n * n * sizeof(int) : 0) + _dim * (1 + sizeof(unsigned)))
+        + (triangleOffset.size() + vertexOffset.size()) * sizeof(unsigned);
+    notePeakMeshingBytes(meshingBytes() + scratchBytes);
+
+    // Second pass: every slab writes its triangles, and the vertices of its layer, at
+    // the offsets found above.
+    #pragma omp parallel
+    {
+        PROFILE_SCOPE("writePass");
+        EdgeCache cache;
+        if(indexed)
+            cache.resize(n);
+        std::vector<unsigned char> cases(_dim);
+        std::vector<unsigned> active(_dim);
+
+        #pragma omp for schedule(dynamic)
+        for (int x = 0; x < (int)_dim; x++)
+        {
+            if(indexed)
+            {
+                // The vertices of the upper plane belong to the next layer, only the
+                // last slab writes them itself.
+                numberLayer(x, vertexOffset[x], &cache.lowPlane[0], &cache.slabEdges[0], true);
+                numberLayer(x + 1, vertexOffset[x + 1], &cache.highPlane[0], NULL, x + 1 == (int)_dim);
+            }
+
+            unsigned triangle = triangleOffset[x];
+            for (unsigned y = 0; y < _dim; y++)
+            {
+                const unsigned activeCubes = classifyRow(x, y, &cases[0], &active[0]);
+
+                for (unsigned a = 0; a < activeCubes; a++)
+                {
+                    const unsigned z = active[a];
+                    const int *triangles = _table.triangleTable[cases[z]];
+                    for(unsigned t = 0; t < 16 && triangles[t] != -1; t += 3, triangle++)
+                    {
+                        if(indexed)
+                        {
+                            int ids[3];
+                            for(unsigned i = 0; i < 3; i++)
+                            {
+                                const int *edge = edgeOrigin[triangles[t + i]];
+                                const unsigned e = (y + edge[1]) * n + (z + edge[2]);
+                                ids[i] = edge[3] == 0 ? cache.slabEdges[e]
+                                    : (edge[0] ? cache.highPlane : cache.lowPlane)[2 * e + edge[3] - 1];
+                            }
+                            _indices[triangle] = glm::ivec3(ids[0], ids[1], ids[2]);
+                        }
+                        else
+                        {
+                            for(unsigned i = 0; i < 3; i++)
+                            {
+                                glm::ivec3 pos1, pos2;
+                                getEdgePositions(triangles[t + i], x, y, z, pos1, pos2);
+                                createVertex(pos1, pos2, _VBOarray[6 * triangle + 2 * i], _VBOarray[6 * triangle + 2 * i + 1]);
+                            }
+                            _indices[triangle] = glm::ivec3(3 * triangle, 3 * triangle + 1, 3 * triangle + 2);
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+void VoxelData::activeSpans(const unsigned x, const unsigned y, std::vector<unsigned> &spans) const
+{
+    // An edge leaving grid point (x, y, z) is an edge of the cube min((x, y, z), dim - 1),
+    // so it can only cross the isovalue if that cube's brick is active.
+    const unsigned bricks = _bricks.bricksPerAxis();
+    const unsigned cx = std::min(x, _dim - 1) / BrickPyramid::BRICK;
+    const unsigned cy = std::min(y, _dim - 1) / BrickPyramid::BRICK;
+    const unsigned char *brickRow = &_activeBricks[(cx * bricks + cy) * bricks];
+
+    spans.clear();
+    for(unsigned first = 0; first < bricks;)
+    {
+        if(!brickRow[first])
+        {
+            first++;
+            continue;
+        }
+        unsigned last = first;
+        while(last < bricks && brickRow[last])
+            last++;
+
+        // The last brick also owns the grid points on the upper face.
+        spans.push_back(first * BrickPyramid::BRICK);
+        spans.push_back(last == bricks ? _dim + 1 : last * BrickPyramid::BRICK);
+        first = last;
+    }
+}
+
+unsigned VoxelData::numberLayer(const unsigned x, const unsigned firstId, int *planeIds, int *xEdgeIds, const bool writeVertices)
+{
+    // Number of grid points along each axis.
+    const unsigned n = _dim + 1;
+    unsigned id = firstId;
+
+    if(planeIds)
+        std::fill(planeIds, planeIds + 2 * n * n, -1);
+    if(xEdgeIds)
+        std::fill(xEdgeIds, xEdgeIds + n * n, -1);
+
+    // Visit the intersected edges of the layer in a fixed order, so every slab that
+    // touches the layer arrives at the same ids. Only the spans of active bricks
+    // can hold any.
+    std::vector<unsigned> spans;
+    for (unsigned y = 0; y < n; y++)
+    {
+        activeSpans(x, y, spans);
+        if(spans.empty())
+            continue;
+        const float *row = _data.row(x, y);
+        const float *rowAbove = _data.row(x, std::min(y + 1, _dim));
+
+        for (unsigned s = 0; s < spans.size(); s += 2)
+        {
+            for (unsigned z = spans[s]; z < spans[s + 1]; z++)
+            {
+                const bool inside = row[z] > _isovalue;
+                const unsigned e = y * n + z;
+
+                // Edges along y and z in the plane.
+                for(unsigned axis = 1; axis < 3; axis++)
+                {
+                    if((axis == 1 && y == _dim) || (axis == 2 && z == _dim))
+                        continue;
+                    const float other = axis == 1 ? rowAbove[z] : row[z + 1];
+                    if(inside == (other > _isovalue))
+                        continue;
+
+                    if(planeIds)
+                        planeIds[2 * e + axis - 1] = id;
+                    if(writeVertices)
+                    {
+                        glm::ivec3 pos1(x, y, z);
+                        glm::ivec3 pos2 = pos1;
+                        pos2[axis]++;
+                        createVertex(pos1, pos2, _VBOarray[2 * id], _VBOarray[2 * id + 1]);
+                    }
+                    id++;
+                }
+            }
+        }
+    }
+
+    // Edges along x, leaving the plane.
+    if(x < _dim)
+    {
+        for (unsigned y = 0; y < n; y++)
+        {
+            activeSpans(x, y, spans);
+            if(spans.empty())
+                continue;
+            const float *row = _data.row(x, y);
+            const float *rowNext = _data.row(x + 1, y);
+
+            for (unsigned s = 0; s < spans.size(); s += 2)
+            {
+                for (unsigned z = spans[s]; z < spans[s + 1]; z++)
+                {
+                    if((row[z] > _isovalue) == (rowNext[z] > _isovalue))
+                        continue;
+
+                    if(xEdgeIds)
+                        xEdgeIds[y * n + z] = id;
+                    if(writeVertices)
+                        createVertex(glm::ivec3(x, y, z), glm::ivec3(x + 1, y, z), _VBOarray[2 * id], _VBOarray[2 * id + 1]);
+                    id++;
+                }
+            }
+        }
+    }
+
+    return id - firstId;
+}
+
+void VoxelData::createTriangle(unsigned e1, unsigned e2, unsigned e3, const unsigned x, const unsigned y, const unsigned z, MeshBlock &out)
+{
+
+    unsigned edges[] = {e1, e2, e3};
+
+    // Loop through the three edges.
+    for(unsigned i = 0; i < 3; i++)
+    {
+        glm::ivec3 pos1, pos2;
+        getEdgePositions(edges[i], x, y, z, pos1, pos2);
+
+        glm::vec3 vertex, normal;
+        createVertex(pos1, pos2, vertex, normal);
+
+        out.vertices.push_back(vertex);
+        out.normals.push_back(normal);
+    }
+
+    const int first = out.vertices.size() - 3;
+    out.indices.push_back(glm::ivec3(first, first + 1, first + 2));
+}
+
+void VoxelData::getEdgePositions(const unsigned edge, const unsigned x, const unsigned y, const unsigned z, glm::ivec3 &pos1, glm::ivec3 &pos2) const
+{
+    unsigned v1, v2;
+
+    // Determine which vertices v1 & v2 in a cube are connected to the current edge.
+    if(edge < 8)
+    {
+        v1 = edge;
+        v2 = ((edge+1) % 4) + ((edge / 4) * 4);
+    }
+    else
+    {
+        v1 = edge - 4;
+        v2 = edge - 8;
+    }
+
+    // Get the grid position for the two vertices (not yet between 0 and 1).
+    pos1 = getPosition(v1, x, y, z);
+    pos2 = getPosition(v2, x, y, z);
+}
+
+size_t VoxelData::meshingBytes() const
+{
+    // Memory held by the volume, its brick ranges and the mesh arrays.
+    return _data.bytes() + _bricks.bytes() + _activeBricks.capacity()
+        + (_vertices.capacity() + _normals.capacity() + _VBOarray.capacity()) * sizeof(glm::vec3)
+        + _indices.capacity() * sizeof(glm::ivec3) + _gradients.capacity() * sizeof(float) + _gradientRows.capacity() * sizeof(int);
+}
+
+void VoxelData::createVertex(const glm::ivec3 &edgeStart, const glm::ivec3 &edgeEnd, glm::vec3 &vertex, glm::vec3 &normal) const
+{
+    // Seamless cells interpolate every edge from its lower end, so both cells on a
+    // border create the same vertex for the edges they share.
+    const bool swap = _seamless && (edgeEnd.x < edgeStart.x || edgeEnd.y < edgeStart.y || edgeEnd.z < edgeStart.z);
+    const glm::ivec3 pos1 = swap ? edgeEnd : edgeStart;
+    const glm::ivec3 pos2 = swap ? edgeStart : edgeEnd;
 
-        // Find the voxel value for the two vertices.
-        float d1 = _data[pos1.x][pos1.y][pos1.z];
-        float d2 = _data[pos2.x][pos2.y][pos2.z];
+    // Find the voxel value for the two vertices.
+    float d1 = _data(pos1.x, pos1.y, pos1.z);
+    float d2 = _data(pos2.x, pos2.y, pos2.z);
+    float t = (_isovalue - d1) / (d2 - d1);
 
+    if(_seamless)
+    {
+        // The interpolated point on the shared lattice, shifted like every other cell.
+        // On a border bent to a coarser neighbour it moves onto the neighbour's surface.
+        glm::vec3 gridPos = (glm::vec3)pos1 + (glm::vec3)(pos2 - pos1) * t;
+        if(conforming())
+            conformVertex(pos1, pos2, gridPos);
+        vertex = getWorldPosition(gridPos) - glm::vec3(0.5f) * _gridSize;
+    }
+    else
+    {
         // "Normalize" the positions so that the maximum value is 1 and minimum 0.
         glm::vec3 normalizedPos1 = ((glm::vec3)pos1 * (1.0f / (float)_dim)) * _gridSize;
         glm::vec3 normalizedPos2 = ((glm::vec3)pos2 * (1.0f / (float)_dim)) * _gridSize;
 
         // Interpolate between them with the given isovalue.
-        glm::vec3 interpolatedPos = normalizedPos1 + ((normalizedPos2 - normalizedPos1) * ((_isovalue - d1) / (d2 - d1)));
+        glm::vec3 interpolatedPos = normalizedPos1 + ((normalizedPos2 - normalizedPos1) * t);
         
         // Center the vertex (so that the whole grid is centered around origo) and add it to the array.
         glm::vec3 center = _gridCenter + glm::vec3(0.5f, 0.5f, 0.5f) * _gridSize;
 
-        glm::vec3 normal = glm::vec3(0);
-        // Calculate normal from a coarse estimation of the gradient
-        for(int dx = -1; dx <= 1; dx++)
-            for(int dy = -1; dy <= 1; dy++)
-                for(int dz = -1; dz <= 1; dz++)
-                {
-                    int x1_clamped = clamp(pos1.x + dx, 0, _dim - 1);
-                    int y1_clamped = clamp(pos1.y + dy, 0, _dim - 1);
-                    int z1_clamped = clamp(pos1.z + dz, 0, _dim - 1);
-                    normal += glm::vec3(dx, dy, dz) * _data[x1_clamped][y1_clamped][z1_clamped];                        
-
-                    int x2_clamped = clamp(pos2.x + dx, 0, _dim - 1);
-                    int y2_clamped = clamp(pos2.y + dy, 0, _dim - 1);
-                    int z2_clamped = clamp(pos2.z + dz, 0, _dim - 1);
-                    normal += glm::vec3(dx, dy, dz) * _data[x2_clamped][y2_clamped][z2_clamped];                                            
-                }
+        vertex = interpolatedPos - center;
+    }
 
-        tempVert.push_back(interpolatedPos - center);
-        tempNormal.push_back(normal);
+    if(_normalMode == NORMALS_ANALYTIC)
+    {
+        normal = analyticNormal((glm::vec3)pos1 + (glm::vec3)(pos2 - pos1) * t);
+        return;
     }
 
-    #pragma omp critical
+    if(_normalMode == NORMALS_CENTRAL)
     {
-        _vertices.insert(_vertices.end(), tempVert.begin(), tempVert.end());
-        _normals.insert(_normals.end(), tempNormal.begin(), tempNormal.end());
-    
-        _indices.push_back(glm::ivec3(_vertices.size() - 3, _vertices.size() - 2, _vertices.size() - 1));
-        
+        // Interpolate the precomputed gradients at the same point as the position.
+        const glm::vec3 g1 = gradientAt(pos1);
+        normal = glm::normalize(g1 + (gradientAt(pos2) - g1) * t);
+        return;
     }
+
+    // Without an apron the neighbourhood is clamped to the volume (short of its last
+    // sample, as it always was), with one it is always there.
+    const int low = -(int)_data.apron();
+    const int high = _data.apron() ? _dim + _data.apron() : _dim - 1;
+
+    normal = glm::vec3(0);
+    // Calculate normal from a coarse estimation of the gradient
+    for(int dx = -1; dx <= 1; dx++)
+        for(int dy = -1; dy <= 1; dy++)
+            for(int dz = -1; dz <= 1; dz++)
+            {
+                int x1_clamped = clamp(pos1.x + dx, low, high);
+                int y1_clamped = clamp(pos1.y + dy, low, high);
+                int z1_clamped = clamp(pos1.z + dz, low, high);
+                normal += glm::vec3(dx, dy, dz) * _data(x1_clamped, y1_clamped, z1_clamped);                        
+
+                int x2_clamped = clamp(pos2.x + dx, low, high);
+                int y2_clamped = clamp(pos2.y + dy, low, high);
+                int z2_clamped = clamp(pos2.z + dz, low, high);
+                normal += glm::vec3(dx, dy, dz) * _data(x2_clamped, y2_clamped, z2_clamped);                                            
+            }
+}
+
+const glm::vec3 VoxelData::analyticNormal(const glm::vec3 &gridPos) const
+{
+    // The field generateData samples, at a point between the grid points.
+    const float scale = _gridSize / (float)_dim;
+    const glm::vec3 pos = getWorldPosition(gridPos);
+
+    glm::vec3 gradient;
+    fbm3Gradient(_fbm, pos.x, pos.y, pos.z, &gradient.x, &gradient.y, &gradient.z);
+
+    // Chain rule back to grid units, plus the slope of the y-plane.
+    gradient *= scale;
+    gradient.y += _seamless ? 1.0f / (float)_dim : 1.0f / (float)(_dim + 1);
+
+    return glm::normalize(gradient);
 }
 
 const glm::ivec3 VoxelData::getPosition(const unsigned v, unsigned x, unsigned y, unsigned z) const
@@ -255,99 +1139,335 @@ const glm::ivec3 VoxelData::getPosition(const unsigned v, unsigned x, unsigned y
     return glm::vec3(x, y, z);
 }
 
-const glm::vec3 VoxelData::getWorldPosition(const unsigned x, const unsigned y, const unsigned z) const
+bool VoxelData::setNeighbourDimension(const Face face, const unsigned dim)
 {
-    glm::vec3 pos = (glm::vec3(x,y,z) * (1.0f / (float)_dim)) * _gridSize;
-    return pos - _gridCenter;
+    _coarseRatio[face] = 1;
+    if(!_seamless || dim == 0 || dim >= _dim)
+        return dim >= _dim;
+
+    // Only neighbours with a power of two fewer samples share a lattice with this cell.
+    const unsigned ratio = _dim / dim;
+    if(_dim % dim != 0 || (ratio & (ratio - 1)) != 0)
+        return false;
+    _coarseRatio[face] = ratio;
+    return true;
 }
 
-void VoxelData::draw() const
+bool VoxelData::setCornerDimension(const Face xFace, const Face zFace, const unsigned dim)
 {
-    glEnable(GL_CULL_FACE);
-	glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    
-    glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec3) * _VBOarray.size(), &_VBOarray[0], GL_STATIC_DRAW);
-    glBindVertexArray(VAO);
+    unsigned &corner = _cornerRatio[xFace & 1][zFace & 1];
+    corner = 1;
+    if(xFace >= FACE_LOW_Z || zFace < FACE_LOW_Z)
+        return false;
+    if(!_seamless || dim == 0 || dim >= _dim)
+        return dim >= _dim;
 
-    glDrawElements(GL_TRIANGLES, sizeof(glm::ivec3) * _indices.size(), GL_UNSIGNED_INT, 0);
-
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
+    const unsigned ratio = _dim / dim;
+    if(_dim % dim != 0 || (ratio & (ratio - 1)) != 0)
+        return false;
+    corner = ratio;
+    return true;
 }
 
-void VoxelData::drawBoundingBox() const
+bool VoxelData::conforming() const
 {
-    glDisable(GL_CULL_FACE);
-	glBindBuffer(GL_ARRAY_BUFFER, VBO_b);
-    
-    glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec3) * _boundingBoxVertices.size(), &_boundingBoxVertices[0], GL_STATIC_DRAW);
-    glBindVertexArray(VAO_b);
-
-    glDrawElements(GL_LINES, sizeof(unsigned) * _boundingBoxIndices.size(), GL_UNSIGNED_INT, 0);
+    return _coarseRatio[0] > 1 || _coarseRatio[1] > 1 || _coarseRatio[2] > 1 || _coarseRatio[3] > 1
+        || _cornerRatio[0][0] > 1 || _cornerRatio[0][1] > 1 || _cornerRatio[1][0] > 1 || _cornerRatio[1][1] > 1;
+}
 
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
+unsigned VoxelData::edgeRatio(const Face face, const int w) const
+{
+    // The other face through the vertical edge of the volume at w on this face, and the
+    // cell across the edge.
+    const bool xFace = face < FACE_LOW_Z;
+    const Face other = xFace ? (w == 0 ? FACE_LOW_Z : FACE_HIGH_Z) : (w == 0 ? FACE_LOW_X : FACE_HIGH_X);
+    const unsigned corner = xFace ? _cornerRatio[face & 1][w != 0] : _cornerRatio[w != 0][face & 1];
+    return std::max(std::max(_coarseRatio[face], _coarseRatio[other]), corner);
+}
 
+// The face's samples are addressed by (y, w), where w is z on the x-faces and x on the z-faces.
+static glm::ivec3 facePoint(const VoxelData::Face face, const int dim, const int y, const int w)
+{
+    const int plane = (face & 1) ? dim : 0;
+    return face < VoxelData::FACE_LOW_Z ? glm::ivec3(plane, y, w) : glm::ivec3(w, y, plane);
 }
 
+void VoxelData::conformBorders()
+{
+    PROFILE_SCOPE("conformBorders");
+    const int dim = _dim;
 
+    // The vertical edges of the volume first. Every cell around one takes the coarsest
+    // lattice among them, and is linear in between.
+    for(unsigned f = 0; f < 4; f++)
+        for(int w = 0; w <= dim; w += dim)
+        {
+            const int r = edgeRatio((Face)f, w);
+            for(int y = 0; y < dim && r > 1; y++)
+            {
+                if(y % r == 0)
+                    continue;
+                const float s = (float)(y % r) / (float)r;
+                const glm::ivec3 a = facePoint((Face)f, dim, y - y % r, w), b = facePoint((Face)f, dim, y - y % r + r, w);
+                const glm::ivec3 p = facePoint((Face)f, dim, y, w);
+                _data.set(p.x, p.y, p.z, _data(a.x, a.y, a.z) + (_data(b.x, b.y, b.z) - _data(a.x, a.y, a.z)) * s);
+            }
+        }
 
-void VoxelData::createVBO()
-{
-    for(unsigned i = 0; i < _vertices.size(); i++)
+    // Then each face interpolates the squares of the neighbour's lattice. A square with
+    // two opposite corners inside is split into four triangles around a center that is
+    // outside, which keeps the inside corners apart the way the lookup table does.
+    for(unsigned f = 0; f < 4; f++)
     {
-        _VBOarray.push_back(_vertices[i]);
-        _VBOarray.push_back(_normals[i]);
+        const int r = _coarseRatio[f];
+        if(r <= 1)
+            continue;
+
+        #pragma omp parallel for
+        for(int sy = 0; sy < dim; sy += r)
+            for(int sw = 0; sw < dim; sw += r)
+            {
+                float c[2][2];
+                for(int i = 0; i < 2; i++)
+                    for(int j = 0; j < 2; j++)
+                    {
+                        const glm::ivec3 p = facePoint((Face)f, dim, sy + i * r, sw + j * r);
+                        c[i][j] = _data(p.x, p.y, p.z);
+                    }
+
+                const bool in00 = c[0][0] > _isovalue, in10 = c[1][0] > _isovalue;
+                const bool ambiguous = in00 == (c[1][1] > _isovalue) && in10 == (c[0][1] > _isovalue) && in00 != in10;
+                const float center = in00 ? 0.5f * (c[1][0] + c[0][1]) : 0.5f * (c[0][0] + c[1][1]);
+
+                for(int dy = 0; dy <= r; dy++)
+                    for(int dw = 0; dw <= r; dw++)
+                    {
+                        // Corners stay, the vertical edges of the volume are done.
+                        const int w = sw + dw;
+                        if((dy % r == 0 && dw % r == 0) || w == 0 || w == dim)
+                            continue;
+
+                        const float s = (float)dy / (float)r, t = (float)dw / (float)r;
+                        float value;
+                        if(!ambiguous)
+                            value = (1.0f - s) * ((1.0f - t) * c[0][0] + t * c[0][1]) + s * ((1.0f - t) * c[1][0] + t * c[1][1]);
+                        else if(fabsf(t - 0.5f) >= fabsf(s - 0.5f))
+                        {
+                            // The triangle on the side at t = 0 or t = 1.
+                            const float u = t < 0.5f ? t : 1.0f - t;
+                            const int j = t < 0.5f ? 0 : 1;
+                            value = (1.0f - s - u) * c[0][j] + (s - u) * c[1][j] + 2.0f * u * center;
+                        }
+                        else
+                        {
+                            // The triangle on the side at s = 0 or s = 1.
+                            const float u = s < 0.5f ? s : 1.0f - s;
+                            const int i = s < 0.5f ? 0 : 1;
+                            value = (1.0f - t - u) * c[i][0] + (t - u) * c[i][1] + 2.0f * u * center;
+                        }
+
+                        const glm::ivec3 p = facePoint((Face)f, dim, sy + dy, w);
+                        _data.set(p.x, p.y, p.z, value);
+                    }
+            }
     }
 }
 
-void VoxelData::createBuffers()
+glm::vec3 VoxelData::coarseCrossing(const glm::ivec3 &pos, const int axis, const int spacing) const
 {
-    glGenVertexArrays(1, &VAO);
-	glGenBuffers(1, &VBO);
-	glGenBuffers(1, &EBO);
-	// Bind the Vertex Array Object first, then bind and set vertex buffer(s) and attribute pointer(s).
-	glBindVertexArray(VAO);
+    // The same vertex the coarser cell creates on its edge through pos, in this cell's
+    // units. The spacing is a power of two, so scaling the coarse cell's arithmetic by it
+    // is exact and both cells end up at the same world position.
+    glm::ivec3 low = pos, high = pos;
+    low[axis] = pos[axis] - pos[axis] % spacing;
+    high[axis] = low[axis] + spacing;
+    const float d1 = _data(low.x, low.y, low.z);
+    const float d2 = _data(high.x, high.y, high.z);
+    const float t = (_isovalue - d1) / (d2 - d1);
+    return (glm::vec3)low + (glm::vec3)(high - low) * t;
+}
 
-	glBindBuffer(GL_ARRAY_BUFFER, VBO);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec3) * _VBOarray.size(), &_VBOarray[0], GL_STATIC_DRAW);
+void VoxelData::conformVertex(const glm::ivec3 &pos1, const glm::ivec3 &pos2, glm::vec3 &gridPos) const
+{
+    const int dim = _dim;
 
+    // On a vertical edge of the volume the vertex is on the lattice all cells around
+    // it bent the edge to, even when it only is coarser across the corner.
+    if(pos1.y != pos2.y && (pos1.x == 0 || pos1.x == dim) && (pos1.z == 0 || pos1.z == dim))
+    {
+        const unsigned r = edgeRatio(pos1.x == 0 ? FACE_LOW_X : FACE_HIGH_X, pos1.z);
+        if(r > 1)
+            gridPos = coarseCrossing(pos1, 1, r);
+        return;
+    }
 
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(glm::ivec3) * _indices.size(), &_indices[0], GL_STATIC_DRAW);
+    for(unsigned f = 0; f < 4; f++)
+    {
+        const int r = _coarseRatio[f];
+        const int fixed = f < FACE_LOW_Z ? 0 : 2;
+        const int plane = (f & 1) ? dim : 0;
+        if(r <= 1 || pos1[fixed] != plane || pos2[fixed] != plane)
+            continue;
 
-	//Vertex position attribute
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 2 * sizeof(glm::vec3), (GLvoid*)0);
-	glEnableVertexAttribArray(0);
-	//Vertex normal attribute
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 2 * sizeof(glm::vec3), (GLvoid*)(sizeof(glm::vec3)));
-	glEnableVertexAttribArray(1);
-	//Vertex color attribute
-	//glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(glm::vec3), (GLvoid*)(2 * sizeof(glm::vec3)));
-	//glEnableVertexAttribArray(2);
+        // The edge runs along y or w, and sits at c on the other of the two.
+        const int wAxis = 2 - fixed;
+        const int axis = pos1.y != pos2.y ? 1 : wAxis;
+        const int c = pos1[axis == 1 ? wAxis : 1];
 
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
-    
+        // On a line of the coarse lattice the vertex is the coarser cell's vertex.
+        if(c % r == 0)
+        {
+            gridPos = coarseCrossing(pos1, axis, r);
+            return;
+        }
+
+        // Inside a square of it, the vertex snaps to an end of the coarser cell's segment
+        // across the square, where the square's sides cross the isovalue. The face's
+        // vertices then all are the coarser cell's, so no edge of one mesh ends on an
+        // edge of the other, and the triangles between two vertices snapped together
+        // have no area and are dropped.
+        const int sy = pos1.y - pos1.y % r, sw = pos1[wAxis] - pos1[wAxis] % r;
+        const glm::ivec3 corner[4] = {facePoint((Face)f, dim, sy, sw), facePoint((Face)f, dim, sy + r, sw),
+            facePoint((Face)f, dim, sy + r, sw + r), facePoint((Face)f, dim, sy, sw + r)};
+        bool inside[4];
+        for(unsigned k = 0; k < 4; k++)
+            inside[k] = _data(corner[k].x, corner[k].y, corner[k].z) > _isovalue;
+
+        // Side k runs from corner k to corner k + 1, the sides along y lie on the
+        // vertical edges of the volume at its faces.
+        glm::vec3 crossing[4];
+        bool crossed[4];
+        unsigned crossings = 0;
+        for(unsigned k = 0; k < 4; k++)
+        {
+            crossed[k] = inside[k] != inside[(k + 1) % 4];
+            if(!crossed[k])
+                continue;
+            crossings++;
+            const glm::ivec3 &start = corner[k].y <= corner[(k + 1) % 4].y && corner[k][wAxis] <= corner[(k + 1) % 4][wAxis] ? corner[k] : corner[(k + 1) % 4];
+            const bool alongY = k % 2 == 0;
+            const int w = start[wAxis];
+            const int spacing = alongY && (w == 0 || w == dim) ? edgeRatio((Face)f, w) : r;
+            crossing[k] = coarseCrossing(start, alongY ? 1 : wAxis, spacing);
+        }
+        if(crossings < 2)
+            return;
+
+        // Two crossings make one segment, four make one around each inside corner.
+        glm::vec3 best = gridPos;
+        float bestDistance = FLT_MAX;
+        for(unsigned k = 0; k < 4; k++)
+        {
+            glm::vec3 a, b;
+            if(crossings == 2)
+            {
+                if(!crossed[k])
+                    continue;
+                unsigned other = (k + 1) % 4;
+                while(!crossed[other])
+                    other = (other + 1) % 4;
+                a = crossing[k];
+                b = crossing[other];
+            }
+            else
+            {
+                // Corner k is between sides k - 1 and k.
+                if(!inside[k])
+                    continue;
+                a = crossing[(k + 3) % 4];
+                b = crossing[k];
+            }
+
+            const glm::vec3 ab = b - a;
+            const float length = glm::dot(ab, ab);
+            const float s = length > 0.0f ? glm::clamp(glm::dot(gridPos - a, ab) / length, 0.0f, 1.0f) : 0.0f;
+            const glm::vec3 projected = a + ab * s;
+            const float distance = glm::dot(projected - gridPos, projected - gridPos);
+            if(distance < bestDistance)
+            {
+                best = s < 0.5f ? a : b;
+                bestDistance = distance;
+            }
+        }
+        gridPos = best;
+        return;
+    }
+}
 
-    // Do the same for bounding box
-    glGenVertexArrays(1, &VAO_b);
-	glGenBuffers(1, &VBO_b);
-	glGenBuffers(1, &EBO_b);
-	// Bind the Vertex Array Object first, then bind and set vertex buffer(s) and attribute pointer(s).
-	glBindVertexArray(VAO_b);
+void VoxelData::dropCollapsedTriangles()
+{
+    // Drop the triangles between vertices snapped to the same coarse vertex.
+    size_t kept = 0;
+    for(size_t t = 0; t < _indices.size(); t++)
+    {
+        const glm::ivec3 &triangle = _indices[t];
+        const glm::vec3 &a = _VBOarray[2 * triangle.x], &b = _VBOarray[2 * triangle.y], &c = _VBOarray[2 * triangle.z];
+        if(a != b && b != c && c != a)
+            _indices[kept++] = triangle;
+    }
+    if(kept == _indices.size())
+        return;
+    _indices.resize(kept);
+
+    // Then the vertices no triangle uses any more. The rest keep their order, so an
+    // unindexed mesh still has the vertices of triangle t at 3t to 3t + 2.
+    std::vector<int> remap(_VBOarray.size() / 2, -1);
+    for(size_t t = 0; t < _indices.size(); t++)
+        for(unsigned k = 0; k < 3; k++)
+            remap[_indices[t][k]] = 0;
+    int used = 0;
+    for(size_t v = 0; v < remap.size(); v++)
+    {
+        if(remap[v] < 0)
+            continue;
+        _VBOarray[2 * used] = _VBOarray[2 * v];
+        _VBOarray[2 * used + 1] = _VBOarray[2 * v + 1];
+        remap[v] = used++;
+    }
+    _VBOarray.resize(2 * used);
+    for(size_t t = 0; t < _indices.size(); t++)
+        _indices[t] = glm::ivec3(remap[_indices[t].x], remap[_indices[t].y], remap[_indices[t].z]);
+}
+
+float VoxelData::planeValue(const int y) const
+{
+    // Seamless cells of different dims must agree on the field, so their plane does not
+    // depend on the dim.
+    return _seamless ? (float)y / (float)_dim : (float)(y) / (float)(_dim + 1);
+}
 
-	glBindBuffer(GL_ARRAY_BUFFER, VBO_b);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec3) * _boundingBoxVertices.size(), &_boundingBoxVertices[0], GL_STATIC_DRAW);
+const glm::vec3 VoxelData::getWorldPosition(const int x, const int y, const int z) const
+{
+    return getWorldPosition(glm::vec3(x, y, z));
+}
 
+const glm::vec3 VoxelData::getWorldPosition(const glm::vec3 &gridPos) const
+{
+    // Seamless cells move to their place on the shared lattice and then divide by their
+    // dim, rounded exactly unlike a multiplication by its inverse. A point gets the same
+    // coordinates in every cell that has a sample there, whatever their dims.
+    if(_seamless)
+        return ((gridPos + (glm::vec3)(_cell * (int)_dim)) / (float)_dim) * _gridSize;
 
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO_b);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(unsigned) * _boundingBoxIndices.size(), &_boundingBoxIndices[0], GL_STATIC_DRAW);
+    glm::vec3 pos = (gridPos * (1.0f / (float)_dim)) * _gridSize;
+    return pos - _gridCenter;
+}
 
-	//Vertex position attribute
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 1 * sizeof(glm::vec3), (GLvoid*)0);
-	glEnableVertexAttribArray(0);
+void VoxelData::releaseMeshData()
+{
+    std::vector<glm::vec3>().swap(_vertices);
+    std::vector<glm::vec3>().swap(_normals);
+    std::vector<glm::ivec3>().swap(_indices);
+    std::vector<glm::vec3>().swap(_VBOarray);
+}
 
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
-	glBindVertexArray(0);
+void VoxelData::createVBO()
+{
+    PROFILE_SCOPE("createVBO");
+    _VBOarray.reserve(2 * _vertices.size());
+    for(unsigned i = 0; i < _vertices.size(); i++)
+    {
+        _VBOarray.push_back(_vertices[i]);
+        _VBOarray.push_back(_normals[i]);
+    }
 }
@@ -0,0 +1,84 @@
+// Sweeps the camera over a grid of cells and checks after every LodScheduler::update
+// that the levels keep the rules VoxelData needs to bend the borders between cells:
+// neighbours, corners included, at most one level apart, and no cell across a corner
+// coarser than both cells beside it. With and without a triangle budget, the levels
+// only exceed it where even the coarsest one does.
+//
+// Run with ./tests/lodSchedulerTest, returns non-zero on any failure.
+
+#include <iostream>
+#include <vector>
+#include <cstdlib>
+
+#include "lodscheduler.h"
+
+// Number of cells of the current levels that break a rule.
+static unsigned brokenCells(const LodScheduler &lods, const int half)
+{
+    const int side = 2 * half + 1;
+    unsigned broken = 0;
+    for(unsigned cell = 0; cell < lods.numberOfCells(); cell++)
+    {
+        const glm::ivec2 p = lods.cellPosition(cell);
+        bool ok = true;
+        for(int di = -1; di <= 1; di++)
+            for(int dj = -1; dj <= 1; dj++)
+            {
+                const glm::ivec2 q = p + glm::ivec2(di, dj);
+                if(abs(q.x) > half || abs(q.y) > half)
+                    continue;
+                const unsigned dim = lods.dimension(cell);
+                const unsigned neighbour = lods.dimension((q.x + half) * side + q.y + half);
+                ok = ok && neighbour <= 2 * dim && dim <= 2 * neighbour;
+                if(di == 0 || dj == 0)
+                    continue;
+                const unsigned besideI = lods.dimension((q.x + half) * side + p.y + half);
+                const unsigned besideJ = lods.dimension((p.x + half) * side + q.y + half);
+                ok = ok && !(dim < besideI && dim < besideJ);
+            }
+        broken += !ok;
+    }
+    return broken;
+}
+
+int main()
+{
+    const int cellGrid = 14, half = cellGrid / 2;
+    const unsigned dims[] = {100, 128};
+    const size_t budgets[] = {0, 60000, 200000, 1000000};
+    const float heights[] = {0.3f, 1.0f, 4.0f};
+
+    unsigned positions = 0, failures = 0;
+    for(unsigned d = 0; d < sizeof(dims) / sizeof(dims[0]); d++)
+        for(unsigned b = 0; b < sizeof(budgets) / sizeof(budgets[0]); b++)
+        {
+            LodScheduler::Settings settings;
+            settings.dim = dims[d];
+            settings.focalLength = 500.0f;
+            settings.triangleBudget = budgets[b];
+            LodScheduler lods(settings, cellGrid);
+
+            unsigned failed = 0, overBudget = 0;
+            std::vector<unsigned> remesh;
+            for(unsigned h = 0; h < sizeof(heights) / sizeof(heights[0]); h++)
+                for(float x = -3.3f; x <= 3.3f; x += 0.1f)
+                    for(float z = -3.3f; z <= 3.3f; z += 0.1f)
+                    {
+                        lods.update(glm::vec3(x, heights[h], z), 0.0, remesh);
+                        positions++;
+                        if(brokenCells(lods, half) > 0)
+                            failed++;
+                        bool coarsest = true;
+                        for(unsigned cell = 0; cell < lods.numberOfCells(); cell++)
+                            coarsest = coarsest && lods.dimension(cell) == dims[d] >> (lods.levels() - 1);
+                        if(budgets[b] > 0 && lods.estimatedTriangles() > budgets[b] && !coarsest)
+                            overBudget++;
+                    }
+            std::cout << "dim " << dims[d] << ", " << lods.levels() << " levels, budget " << budgets[b]
+                << ": " << failed << " positions break a rule, " << overBudget << " over the budget" << std::endl;
+            failures += failed + overBudget;
+        }
+
+    std::cout << failures << " failures at " << positions << " positions" << std::endl;
+    return failures > 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,208 @@
+// Generates a grid of terrain cells without a window and writes their meshes to
+// disk as Wavefront OBJ or MeshFile files, one per cell, printing how long each phase took.
+// Uses only the terrain library, the cells are generated side by side on a JobPool.
+//
+// Run with ./tools/headless [gridDimension gridSize noiseScale cellGrid isoValue normalMode outputDir threads generationMode format sampleFormat storage].
+// Without an output directory (or with "-") nothing is written, which times generation alone.
+// The generation mode is 0 full, 1 bounded (the default) or 2 truncated.
+// The format is obj (the default) or mesh, which MeshFile::open maps in place.
+// The sample format is 0 float (the default), 1 half, 2 unorm16 or 3 unorm8, the
+// storage dense (the default) or sparse.
+// Set TERRAIN_TRACE to a file name to also record a Chrome trace of the run.
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <cstdlib>
+#include <algorithm>
+
+#include "voxelData.h"
+#include "jobpool.h"
+#include "timingstats.h"
+#include "profiler.h"
+#include "meshfile.h"
+#include "benchclock.h"
+
+// Positions and normals of the interleaved vertex array, then the triangles (OBJ counts from 1).
+static bool writeOBJ(const std::string &path, const std::vector<glm::vec3> &vertexData, const std::vector<glm::ivec3> &indices)
+{
+    std::ofstream file(path.c_str());
+    if(!file)
+        return false;
+
+    file << std::setprecision(7);
+    for(unsigned v = 0; v < vertexData.size(); v += 2)
+        file << "v " << vertexData[v].x << " " << vertexData[v].y << " " << vertexData[v].z << "\n";
+    for(unsigned v = 1; v < vertexData.size(); v += 2)
+        file << "vn " << vertexData[v].x << " " << vertexData[v].y << " " << vertexData[v].z << "\n";
+    for(unsigned t = 0; t < indices.size(); t++)
+    {
+        const glm::ivec3 f = indices[t] + glm::ivec3(1);
+        file << "f " << f.x << "//" << f.x << " " << f.y << "//" << f.y << " " << f.z << "//" << f.z << "\n";
+    }
+    return (bool)file;
+}
+
+struct CellTimes
+{
+    int i, j;
+    unsigned triangles;
+    unsigned bricks, skippedBricks;
+    double noiseWork;
+    double data, mesh, write;
+    bool written;
+};
+
+int main(int argc, const char * argv[])
+{
+    int gridDimension = 100;
+    float gridSize = 0.5;
+    float noiseScale = 0.1;
+    int cellGrid = 3;
+    float isoValue = 0.55;
+    int normalMode = VoxelData::NORMALS_SOBEL;
+    std::string outputDir;
+    unsigned threads = 0;
+    int generationMode = VoxelData::GENERATE_BOUNDED;
+    bool meshFormat = false;
+    int sampleFormat = SampleVolume::FORMAT_FLOAT;
+    bool sparse = false;
+
+    if(argc > 1 && atoi(argv[1]) > 0)
+        gridDimension = atoi(argv[1]);
+    if(argc > 2 && atof(argv[2]) > 0.05)
+        gridSize = atof(argv[2]);
+    if(argc > 3 && atof(argv[3]))
+        noiseScale = atof(argv[3]);
+    if(argc > 4 && atoi(argv[4]) > 0)
+        cellGrid = atoi(argv[4]);
+    if(argc > 5)
+        isoValue = atof(argv[5]);
+    if(argc > 6 && atoi(argv[6]) >= 0 && atoi(argv[6]) <= VoxelData::NORMALS_ANALYTIC)
+        normalMode = atoi(argv[6]);
+    if(argc > 7 && std::string(argv[7]) != "-")
+        outputDir = argv[7];
+    if(argc > 8 && atoi(argv[8]) > 0)
+        threads = atoi(argv[8]);
+    if(argc > 9 && atoi(argv[9]) >= 0 && atoi(argv[9]) <= VoxelData::GENERATE_TRUNCATED)
+        generationMode = atoi(argv[9]);
+    if(argc > 10)
+        meshFormat = std::string(argv[10]) == "mesh";
+    if(argc > 11 && atoi(argv[11]) >= 0 && atoi(argv[11]) < (int)SampleVolume::NUMBER_OF_FORMATS)
+        sampleFormat = atoi(argv[11]);
+    if(argc > 12)
+        sparse = std::string(argv[12]) == "sparse";
+
+    const char *tracePath = getenv("TERRAIN_TRACE");
+    Profiler::setEnabled(tracePath != NULL);
+    Profiler::setThreadName("main");
+
+    JobPool pool(threads);
+    CompletionQueue<CellTimes> finished;
+
+    std::cout << "Generating " << cellGrid << "x" << cellGrid << " cells of " << gridDimension << "^3 on "
+        << pool.size() << " threads" << std::endl;
+
+    // The seamless layout of the streamed world, cell (i, j) is centered at gridSize * (i, 0, j).
+    const double startTime = now();
+    for(int i = 0; i < cellGrid; i++)
+        for(int j = 0; j < cellGrid; j++)
+            pool.submit([=, &finished]
+            {
+                CellTimes times;
+                times.i = i;
+                times.j = j;
+
+                VoxelData volume(gridDimension, gridSize, glm::ivec3(i, 0, j));
+                volume.setNormalMode((VoxelData::NormalMode)normalMode);
+                volume.setGenerationMode((VoxelData::GenerationMode)generationMode, isoValue);
+                volume.setSampleFormat((SampleVolume::Format)sampleFormat, isoValue,
+                    sparse ? SampleVolume::STORAGE_SPARSE : SampleVolume::STORAGE_DENSE);
+
+                double t = now();
+                volume.generateData(noiseScale);
+                times.data = now() - t;
+                times.noiseWork = volume.getNoiseWork();
+
+                t = now();
+                volume.generateTriangles(isoValue);
+                times.mesh = now() - t;
+                times.triangles = volume.getNumberOfTriangles();
+                times.bricks = volume.getNumberOfBricks();
+                times.skippedBricks = volume.getNumberOfSkippedBricks();
+
+                t = now();
+                times.written = true;
+                if(!outputDir.empty())
+                {
+                    PROFILE_SCOPE("write");
+                    std::ostringstream path;
+                    path << outputDir << "/cell_" << i << "_" << j << (meshFormat ? ".mesh" : ".obj");
+                    if(meshFormat)
+                        times.written = MeshFile::write(path.str(), volume.getVertexData(), volume.getIndices());
+                    else
+                        times.written = writeOBJ(path.str(), volume.getVertexData(), volume.getIndices());
+                }
+                times.write = now() - t;
+
+                finished.push(std::move(times));
+            });
+
+    // Per cell timings in milliseconds.
+    TimingStats data, mesh, write;
+    double dataTotal = 0.0, meshTotal = 0.0, writeTotal = 0.0;
+    size_t triangles = 0, bricks = 0, skippedBricks = 0;
+    double noiseWork = 0.0;
+    unsigned failed = 0;
+    for(int c = 0; c < cellGrid * cellGrid; c++)
+    {
+        CellTimes times;
+        finished.waitPop(times);
+        data.add(times.data * 1000.0);
+        mesh.add(times.mesh * 1000.0);
+        write.add(times.write * 1000.0);
+        dataTotal += times.data;
+        meshTotal += times.mesh;
+        writeTotal += times.write;
+        triangles += times.triangles;
+        bricks += times.bricks;
+        skippedBricks += times.skippedBricks;
+        noiseWork += times.noiseWork;
+        if(!times.written)
+        {
+            std::cerr << "Could not write cell " << times.i << ", " << times.j << " to " << outputDir << std::endl;
+            failed++;
+        }
+    }
+    const double wallTime = now() - startTime;
+    // The jobs finish their trace events after handing over their cell.
+    pool.wait();
+
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "phase               total s   p50 ms   p95 ms   max ms" << std::endl;
+    const char *names[] = {"generateData", "generateTriangles", "write"};
+    const TimingStats *stats[] = {&data, &mesh, &write};
+    const double totals[] = {dataTotal, meshTotal, writeTotal};
+    for(unsigned p = 0; p < 3; p++)
+        std::cout << std::left << std::setw(18) << names[p] << std::right
+            << std::setw(10) << totals[p]
+            << std::setw(9) << stats[p]->percentile(50)
+            << std::setw(9) << stats[p]->percentile(95)
+            << std::setw(9) << stats[p]->percentile(100) << std::endl;
+    std::cout << "Triangles: " << triangles << std::endl;
+    std::cout << "Noise work: " << 100.0 * noiseWork / (cellGrid * cellGrid) << "% of a full volume" << std::endl;
+    std::cout << "Skipped bricks: " << skippedBricks << " of " << bricks << " (" << 100.0 * skippedBricks / std::max(bricks, (size_t)1) << "%)" << std::endl;
+    std::cout << "Lock contention: " << pool.contention() + finished.contention() << std::endl;
+    std::cout << "Wall time: " << wallTime << " s (" << cellGrid * cellGrid / wallTime << " cells/s)" << std::endl;
+
+    if(tracePath && !Profiler::writeTrace(tracePath))
+    {
+        std::cerr << "Could not write the trace to " << tracePath << std::endl;
+        failed++;
+    }
+
+    return failed ? 1 : 0;
+}